@@ -0,0 +1,85 @@
+/**
+ * @file admission_policy.h
+ * @author Ryan McMahon (mcmahonryan@hotmail.com)
+ * @brief Limits on how fast a dispatcher takes on new rides.
+ */
+#pragma once
+#include <string>
+
+namespace ride_share {
+
+	using namespace std;
+
+	/// @brief Exception thrown when an AdmissionPolicy is given a limit that would never admit a request.
+	class AdmissionPolicyException {
+	public:
+		AdmissionPolicyException() {
+			info_ = "";
+		}
+		AdmissionPolicyException(const char* info) {
+			info_ = info;
+		}
+		AdmissionPolicyException(const string& info) {
+			info_ = info;
+		}
+		string get_info() { return info_; }
+	private:
+		string info_;
+	};
+
+	/// @brief What Dispatcher::submit_request() did with a request.
+	enum class AdmissionOutcome {
+		/// The ride is active and the car can be sent for it this step.
+		Admitted,
+		/// The ride is waiting in the deferred queue and will be admitted in a later step.
+		Deferred,
+		/// The ride was turned away because the deferred queue is full.
+		Rejected
+	};
+
+	/// @brief Limits applied to every ride request a Dispatcher receives.
+	///
+	/// Choosing the next passenger costs O(n^2) in the active passengers, so capping the active set caps
+	/// the cost of a step. A request that doesn't fit is deferred rather than refused while the deferred
+	/// queue has room. Deferred requests are admitted in arrival order at the start of later steps, and a
+	/// new request never overtakes them. A negative limit means no limit. The default policy admits
+	/// everything immediately. An intake or active limit of 0 throws AdmissionPolicyException: every
+	/// request would wait in the deferred queue forever, and the dispatcher would never be done.
+	class AdmissionPolicy {
+	public:
+		AdmissionPolicy() : max_intake_per_tick_(-1), max_active_(-1), max_deferred_(-1) {}
+
+		/// @brief Most requests admitted from the start of one step to the start of the next.
+		void set_max_intake_per_tick(int max_intake) {
+			check_admitting_limit(max_intake, "intake per tick");
+			max_intake_per_tick_ = max_intake;
+		}
+		int get_max_intake_per_tick() const { return max_intake_per_tick_; }
+
+		/// @brief Most passengers with an active ride, waiting or aboard.
+		void set_max_active(int max_active) {
+			check_admitting_limit(max_active, "active passengers");
+			max_active_ = max_active;
+		}
+		int get_max_active() const { return max_active_; }
+
+		/// @brief Most requests held in the deferred queue; 0 rejects whatever can't be admitted at once.
+		void set_max_deferred(int max_deferred) { max_deferred_ = max_deferred; }
+		int get_max_deferred() const { return max_deferred_; }
+
+	private:
+		/// @brief Throws AdmissionPolicyException if @p limit, on @p what, would never admit anything.
+		static void check_admitting_limit(int limit, const char* what) {
+			if (limit == 0) {
+				string info = string("Admission limit on ") + what + " can't be 0: no request could ever be admitted";
+				AdmissionPolicyException e(info);
+				throw e;
+			}
+		}
+
+		int max_intake_per_tick_;
+		int max_active_;
+		int max_deferred_;
+	};
+
+}  // namespace ride_share
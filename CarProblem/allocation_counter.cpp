@@ -0,0 +1,77 @@
+/**
+ * @file allocation_counter.cpp
+ * @author Ryan McMahon (mcmahonryan@hotmail.com)
+ */
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#ifdef _WIN32
+#include <malloc.h>
+#else
+#include <stdlib.h>
+#endif
+#include "allocation_counter.h"
+
+static std::atomic<long long> g_num_allocations(0);
+
+void* operator new(std::size_t size) {
+	g_num_allocations.fetch_add(1, std::memory_order_relaxed);
+	void* p = std::malloc(size > 0 ? size : 1);
+	if (!p) {
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void operator delete(void* p) noexcept {
+	std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+	std::free(p);
+}
+
+// Over-aligned allocations have their own entry points. std::pmr::new_delete_resource uses them.
+void* operator new(std::size_t size, std::align_val_t align) {
+	g_num_allocations.fetch_add(1, std::memory_order_relaxed);
+	std::size_t alignment = static_cast<std::size_t>(align);
+	if (alignment < sizeof(void*)) {
+		alignment = sizeof(void*);
+	}
+#ifdef _WIN32
+	void* p = _aligned_malloc(size > 0 ? size : 1, alignment);
+#else
+	void* p = nullptr;
+	if (posix_memalign(&p, alignment, size > 0 ? size : 1) != 0) {
+		p = nullptr;
+	}
+#endif
+	if (!p) {
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void operator delete(void* p, std::align_val_t) noexcept {
+#ifdef _WIN32
+	_aligned_free(p);
+#else
+	std::free(p);
+#endif
+}
+
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept {
+#ifdef _WIN32
+	_aligned_free(p);
+#else
+	std::free(p);
+#endif
+}
+
+namespace ride_share {
+
+	long long AllocationCounter::get_count() {
+		return g_num_allocations.load(std::memory_order_relaxed);
+	}
+
+}  // namespace ride_share
@@ -0,0 +1,20 @@
+/**
+ * @file allocation_counter.h
+ * @author Ryan McMahon (mcmahonryan@hotmail.com)
+ * @brief Counts global heap allocations so tests can assert that a code path does not allocate.
+ */
+#pragma once
+
+namespace ride_share {
+
+	/// @brief Reports how many times the global operator new has been called.
+	///
+	/// Linking allocation_counter.cpp replaces the global allocation functions for the whole program.
+	/// Take the count before and after the code under test and compare.
+	class AllocationCounter {
+	public:
+		/// @brief Returns the number of allocations made so far by any thread.
+		static long long get_count();
+	};
+
+}  // namespace ride_share
@@ -1,20 +1,28 @@
 /**
  * @file car_problem.cpp
  * @author Ryan McMahon (mcmahonryan@hotmail.com)
- * @brief Program entry point. Runs the ride-share test suite.
+ * @brief Program entry point. Runs the ride-share test suite, the benchmarks when given --bench,
+ *        a request server when given --serve <socket path>, or converts a JSON scenario to a ride
+ *        trace when given --convert <JSON path> <trace path>. With --cache <directory>, the test
+ *        suite replays its JSON scenarios through cache files kept in that directory.
  */
 #include <iostream>
+#include <cstring>
 #include "point.h"
 #include "passenger.h"
 #include "dispatcher.h"
+#include "city_grid.h"
 #include "ride_share_tester.h"
+#include "request_server.h"
+#include "mapped_file.h"
+#include "ride_trace.h"
 
 using namespace std;
 using namespace ride_share;
 
-int main()
+int main(int argc, char* argv[])
 {
-    Point::set_grid_dims(10, 10);
+    CityGrid city_grid(10, 10);
 
     // Some early testing I did. Left it here to show my thought process.
 #if 0
@@ -67,7 +75,54 @@ int main()
     cout << j2.dump() << endl;
 #endif
 
-    RideShareTester tester;
-    tester.run_tests();
+    RideShareTester tester(city_grid);
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+        tester.run_benchmarks();
+    }
+    else if (argc > 2 && strcmp(argv[1], "--serve") == 0) {
+        RequestServer server(city_grid, argv[2], chrono::milliseconds(100));
+        try {
+            server.start();
+            cout << "Serving on " << argv[2] << endl;
+            server.run();
+        }
+        catch (ServerException e) {
+            cout << "Server failed: " << e.get_info() << endl;
+            exit(1);
+        }
+    }
+    else if (argc > 3 && strcmp(argv[1], "--convert") == 0) {
+        try {
+            MappedFile json_file(argv[2]);
+            convert_json_to_ride_trace(json_file.get_data(), json_file.get_size(), argv[3]);
+            RideTrace trace(argv[3]);
+            cout << "Wrote " << trace.get_num_steps() << " steps, " << trace.get_num_requests() << " requests to " << argv[3] << endl;
+        }
+        catch (MappedFileException e) {
+            cout << "Conversion failed: " << e.get_info() << endl;
+            exit(1);
+        }
+        catch (JSONException e) {
+            cout << "Conversion failed: " << e.get_info() << endl;
+            exit(1);
+        }
+        catch (TraceException e) {
+            cout << "Conversion failed: " << e.get_info() << endl;
+            exit(1);
+        }
+    }
+    else if (argc > 2 && strcmp(argv[1], "--cache") == 0) {
+        tester.set_scenario_cache_dir(argv[2]);
+        try {
+            tester.run_tests();
+        }
+        catch (TraceException e) {
+            cout << "Scenario cache failed: " << e.get_info() << endl;
+            exit(1);
+        }
+    }
+    else {
+        tester.run_tests();
+    }
     exit(0);
 }
@@ -0,0 +1,48 @@
+/**
+ * @file car_state.cpp
+ * @author Ryan McMahon (mcmahonryan@hotmail.com)
+ */
+#include <thread>
+#include "car_state.h"
+
+namespace ride_share {
+
+	static const uint64_t kHasGoalFlag = (uint64_t)1 << 32;
+
+	CarStateSeqlock::CarStateSeqlock() :
+		sequence_(0),
+		pos_(0),
+		goal_(0),
+		time_and_flags_(0)
+	{
+	}
+
+	void CarStateSeqlock::store(const CarState& state) {
+		uint32_t sequence = sequence_.load(memory_order_relaxed);
+		sequence_.store(sequence + 1, memory_order_relaxed);
+		atomic_thread_fence(memory_order_release);
+		pos_.store(state.get_pos().pack(), memory_order_relaxed);
+		goal_.store(state.get_goal().pack(), memory_order_relaxed);
+		time_and_flags_.store((uint64_t)(uint32_t)state.get_time() | (state.has_goal() ? kHasGoalFlag : 0), memory_order_relaxed);
+		sequence_.store(sequence + 2, memory_order_release);
+	}
+
+	CarState CarStateSeqlock::load() const {
+		for (;;) {
+			uint32_t before = sequence_.load(memory_order_acquire);
+			if (before & 1) {
+				// A store is in progress; it only takes a few instructions, unless the writer was preempted.
+				this_thread::yield();
+				continue;
+			}
+			uint64_t pos = pos_.load(memory_order_relaxed);
+			uint64_t goal = goal_.load(memory_order_relaxed);
+			uint64_t time_and_flags = time_and_flags_.load(memory_order_relaxed);
+			atomic_thread_fence(memory_order_acquire);
+			if (sequence_.load(memory_order_relaxed) == before) {
+				return CarState((int)(uint32_t)time_and_flags, Point::unpack(pos), (time_and_flags & kHasGoalFlag) != 0, Point::unpack(goal));
+			}
+		}
+	}
+
+}  // namespace ride_share
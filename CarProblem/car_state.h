@@ -0,0 +1,59 @@
+/**
+ * @file car_state.h
+ * @author Ryan McMahon (mcmahonryan@hotmail.com)
+ * @brief Seqlock-published car position and goal for reader threads.
+ */
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include "point.h"
+
+namespace ride_share {
+
+	using namespace std;
+
+	/// @brief Where the car is and where it is heading, as of the end of one step.
+	class CarState {
+	public:
+		CarState() : time_(0), has_goal_(false) {}
+		CarState(int time, const Point& pos, bool has_goal, const Point& goal) : time_(time), pos_(pos), has_goal_(has_goal), goal_(goal) {}
+
+		int get_time() const { return time_; }
+		Point get_pos() const { return pos_; }
+		/// @brief Returns false when the car has nowhere to go.
+		bool has_goal() const { return has_goal_; }
+		Point get_goal() const { return goal_; }
+
+	private:
+		int time_;
+		Point pos_;
+		bool has_goal_;
+		Point goal_;
+	};
+
+	/// @brief Holds one CarState that a single writer updates and any number of threads read.
+	///
+	/// A seqlock: the writer bumps the sequence to odd, stores the fields, then bumps it to even. A reader
+	/// copies the fields between two reads of the sequence and retries if it changed, so it never sees a
+	/// mix of two states. The writer never waits for readers, and readers never write shared memory, so
+	/// polling as often as they like costs the writer nothing but the occasional cache miss.
+	class CarStateSeqlock {
+	public:
+		CarStateSeqlock();
+
+		/// @brief Publishes @p state. Only one thread may store.
+		void store(const CarState& state);
+
+		/// @brief Returns the most recently stored state. Safe to call from any thread.
+		CarState load() const;
+
+	private:
+		atomic<uint32_t> sequence_;
+		/// Fields packed into words, copied with relaxed atomics so a racing reader is well defined.
+		atomic<uint64_t> pos_;
+		atomic<uint64_t> goal_;
+		/// Time in the low 32 bits, has_goal in bit 32.
+		atomic<uint64_t> time_and_flags_;
+	};
+
+}  // namespace ride_share
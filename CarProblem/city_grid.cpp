@@ -0,0 +1,22 @@
+/**
+ * @file city_grid.cpp
+ * @author Ryan McMahon (mcmahonryan@hotmail.com)
+ */
+#include "city_grid.h"
+#include "passenger.h"
+
+namespace ride_share {
+
+	CityGrid::CityGrid(int width, int height) {
+		if (width < 1 || height < 1 || width > kMaxDimension || height > kMaxDimension) {
+			PassengerException ex;
+			ex.out_of_range(width, height, "grid size");
+			throw ex;
+		}
+		width_ = width;
+		height_ = height;
+		max_x_ = width - 1;
+		max_y_ = height - 1;
+	}
+
+}  // namespace ride_share
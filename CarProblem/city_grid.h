@@ -0,0 +1,48 @@
+/**
+ * @file city_grid.h
+ * @author Ryan McMahon (mcmahonryan@hotmail.com)
+ * @brief Dimensions and bounds of one simulated city.
+ */
+#pragma once
+#include "point.h"
+
+namespace ride_share {
+
+	/// @brief The grid a single Dispatcher operates on.
+	///
+	/// Each Dispatcher owns its own copy, so dispatchers for differently sized cities can run side by
+	/// side, including on separate threads. Bounds are worked out once, at construction.
+	class CityGrid {
+	public:
+		/// @brief Largest supported width or height. Passenger stores coordinates in 16 bits.
+		static const int kMaxDimension = 65536;
+
+		/// @param width Number of intersections along x.
+		/// @param height Number of intersections along y.
+		/// @throws PassengerException if either dimension is outside [1, kMaxDimension].
+		CityGrid(int width, int height);
+
+		int get_width() const { return width_; }
+		int get_height() const { return height_; }
+		Point get_dims() const { return Point(width_, height_); }
+
+		/// @brief Returns the number of intersections in the city. Computed in 64 bits, since two maximum
+		///        dimensions multiply past the range of int.
+		long long get_num_cells() const { return (long long)width_ * height_; }
+
+		/// @brief Returns the longest possible Manhattan distance between two points in the city.
+		int get_max_dist() const { return max_x_ + max_y_; }
+
+		/// @brief Returns true if @p pt lies inside the city.
+		bool contains(const Point& pt) const {
+			return ((unsigned int)pt.x() <= (unsigned int)max_x_ && (unsigned int)pt.y() <= (unsigned int)max_y_);
+		}
+
+	private:
+		int width_;
+		int height_;
+		int max_x_;
+		int max_y_;
+	};
+
+}  // namespace ride_share
@@ -0,0 +1,168 @@
+/**
+ * @file city_host.cpp
+ * @author Ryan McMahon (mcmahonryan@hotmail.com)
+ */
+#include <chrono>
+#include <exception>
+#include "city_host.h"
+
+namespace ride_share {
+
+	CityHost::CityHost(int num_workers) :
+		round_(0),
+		stopping_(false),
+		tasks_remaining_(0)
+	{
+		if (num_workers < 1) {
+			string info = "A city host needs at least one worker, not " + to_string(num_workers);
+			CityHostException ex(info);
+			throw ex;
+		}
+		for (int i = 0; i < num_workers; i++) {
+			workers_.push_back(unique_ptr<Worker>(new Worker()));
+		}
+		for (int i = 0; i < num_workers; i++) {
+			workers_[i]->thread_ = thread(&CityHost::run_worker, this, i);
+		}
+	}
+
+	CityHost::~CityHost() {
+		{
+			lock_guard<mutex> lock(mutex_);
+			stopping_ = true;
+		}
+		round_started_.notify_all();
+		for (size_t i = 0; i < workers_.size(); i++) {
+			workers_[i]->thread_.join();
+		}
+	}
+
+	int CityHost::add_city(const CityGrid& grid, int queue_capacity, DispatchEventSink* sink) {
+		unique_ptr<City> city(new City(grid, queue_capacity, sink));
+		city->dispatcher_.set_request_queue(&city->queue_);
+		city->home_worker_ = (int)(cities_.size() % workers_.size());
+		cities_.push_back(move(city));
+		return (int)cities_.size() - 1;
+	}
+
+	void CityHost::run_round() {
+		round_cities_.clear();
+		for (size_t i = 0; i < cities_.size(); i++) {
+			if (!cities_[i]->failed_ && !cities_[i]->dispatcher_.is_done()) {
+				round_cities_.push_back((int)i);
+			}
+		}
+		if (round_cities_.empty()) {
+			return;
+		}
+
+		// A worker still leaving the previous round may pick up a task as soon as it is pushed, so the
+		// count has to be in place first.
+		tasks_remaining_ = (int)round_cities_.size();
+		for (size_t i = 0; i < round_cities_.size(); i++) {
+			Worker& worker = *workers_[cities_[round_cities_[i]]->home_worker_];
+			lock_guard<mutex> lock(worker.mutex_);
+			worker.tasks_.push_back(round_cities_[i]);
+		}
+
+		unique_lock<mutex> lock(mutex_);
+		round_++;
+		round_started_.notify_all();
+		round_finished_.wait(lock, [this]() { return tasks_remaining_.load() == 0; });
+	}
+
+	bool CityHost::is_done() {
+		for (size_t i = 0; i < cities_.size(); i++) {
+			if (!cities_[i]->failed_ && !cities_[i]->dispatcher_.is_done()) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void CityHost::get_worker_statistics(int worker, long long* ret_num_tasks, long long* ret_num_steals) const {
+		*ret_num_tasks = workers_[worker]->num_tasks_;
+		*ret_num_steals = workers_[worker]->num_steals_;
+	}
+
+	int CityHost::take_task(int worker_index) {
+		Worker& self = *workers_[worker_index];
+		{
+			lock_guard<mutex> lock(self.mutex_);
+			if (!self.tasks_.empty()) {
+				int city = self.tasks_.back();
+				self.tasks_.pop_back();
+				return city;
+			}
+		}
+		// Try the other workers in turn, starting with the next one, so thieves spread out.
+		int num_workers = (int)workers_.size();
+		for (int offset = 1; offset < num_workers; offset++) {
+			Worker& victim = *workers_[(worker_index + offset) % num_workers];
+			lock_guard<mutex> lock(victim.mutex_);
+			if (!victim.tasks_.empty()) {
+				int city = victim.tasks_.front();
+				victim.tasks_.pop_front();
+				self.num_steals_++;
+				return city;
+			}
+		}
+		return -1;
+	}
+
+	void CityHost::step_city(City& city) {
+		// An exception must not escape the worker thread, which would terminate the process, nor skip
+		// the task count, which would leave run_round() waiting forever.
+		try {
+			if (city.sink_) {
+				city.dispatcher_.update(*city.sink_);
+			}
+			else {
+				city.dispatcher_.update();
+			}
+		}
+		catch (PassengerException e) {
+			city.failed_ = true;
+			city.failure_info_ = e.get_info();
+		}
+		catch (const exception& e) {
+			city.failed_ = true;
+			city.failure_info_ = e.what();
+		}
+		catch (...) {
+			city.failed_ = true;
+			city.failure_info_ = "Unknown exception";
+		}
+	}
+
+	void CityHost::run_worker(int worker_index) {
+		typedef chrono::steady_clock Clock;
+		Worker& self = *workers_[worker_index];
+		long long last_round = 0;
+		for (;;) {
+			{
+				unique_lock<mutex> lock(mutex_);
+				round_started_.wait(lock, [&]() { return stopping_ || round_ != last_round; });
+				if (stopping_) {
+					return;
+				}
+				last_round = round_;
+			}
+
+			int city_index;
+			while ((city_index = take_task(worker_index)) >= 0) {
+				City& city = *cities_[city_index];
+				Clock::time_point start = Clock::now();
+				step_city(city);
+				city.tick_latency_.record(chrono::duration<double, micro>(Clock::now() - start).count());
+				self.num_tasks_++;
+				if (tasks_remaining_.fetch_sub(1) == 1) {
+					// Taking the lock orders this with run_round()'s wait, so the wake-up can't be missed.
+					lock_guard<mutex> lock(mutex_);
+					round_finished_.notify_all();
+				}
+			}
+		}
+	}
+
+}  // namespace ride_share
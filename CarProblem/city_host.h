@@ -0,0 +1,138 @@
+/**
+ * @file city_host.h
+ * @author Ryan McMahon (mcmahonryan@hotmail.com)
+ * @brief Runs many independent cities on a work-stealing thread pool.
+ */
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "dispatcher.h"
+#include "request_queue.h"
+#include "latency_recorder.h"
+
+namespace ride_share {
+
+	using namespace std;
+
+	/// @brief Exception thrown when a CityHost is configured with an invalid number of workers.
+	class CityHostException {
+	public:
+		CityHostException() {
+			info_ = "";
+		}
+		CityHostException(const char* info) {
+			info_ = info;
+		}
+		CityHostException(const string& info) {
+			info_ = info;
+		}
+		string get_info() { return info_; }
+	private:
+		string info_;
+	};
+
+	/// @brief Owns a set of city dispatchers and advances them together, one round at a time.
+	///
+	/// A round steps every unfinished city once. Each city is a task that starts on its home worker's
+	/// deque; a worker runs its own tasks newest first, and when it runs out, steals the oldest task from
+	/// another worker. A city's steps are sequential, so it never runs on two threads at once, but the
+	/// workers that finish quiet cities early go on to take the busy cities' tasks, so CPU time flows to
+	/// wherever the work is. Requests reach a city through its RequestQueue from any thread; everything
+	/// else about a city may only be touched between rounds.
+	///
+	/// If a city's step throws, the exception is caught on the worker and the city is marked failed:
+	/// it is never stepped again and counts as finished, while every other city carries on.
+	class CityHost {
+	public:
+		/// @param num_workers Number of worker threads. Throws CityHostException unless at least 1.
+		explicit CityHost(int num_workers);
+		~CityHost();
+		CityHost(const CityHost&) = delete;
+		CityHost& operator=(const CityHost&) = delete;
+
+		/// @brief Adds a city and returns its index. Cities are assigned to home workers round-robin.
+		/// @param queue_capacity Capacity of the city's request queue.
+		/// @param sink Receives the city's events, on whichever worker steps it; must outlive the host.
+		///        Pass nullptr to discard them.
+		int add_city(const CityGrid& grid, int queue_capacity, DispatchEventSink* sink = nullptr);
+
+		int get_num_cities() const { return (int)cities_.size(); }
+		int get_num_workers() const { return (int)workers_.size(); }
+
+		/// @brief Returns a city's dispatcher. Only use it between rounds.
+		Dispatcher& get_dispatcher(int city) { return cities_[city]->dispatcher_; }
+
+		/// @brief Returns the queue that feeds a city's requests. Safe to push to from any thread.
+		RequestQueue& get_request_queue(int city) { return cities_[city]->queue_; }
+
+		/// @brief Steps every city that isn't done or failed, and returns once they have all finished the step.
+		void run_round();
+
+		/// @brief Returns true when every city is done or has failed.
+		bool is_done();
+
+		/// @brief Returns true if one of the city's steps threw. Only use it between rounds.
+		bool has_failed(int city) const { return cities_[city]->failed_; }
+
+		/// @brief Returns what the failed step threw, or "" if the city hasn't failed.
+		const string& get_failure_info(int city) const { return cities_[city]->failure_info_; }
+
+		/// @brief Returns the time each of a city's steps took, in microseconds.
+		const LatencyRecorder& get_tick_latency(int city) const { return cities_[city]->tick_latency_; }
+
+		/// @brief Returns how many tasks @p worker ran and how many of them it stole from other workers.
+		void get_worker_statistics(int worker, long long* ret_num_tasks, long long* ret_num_steals) const;
+
+	private:
+		struct City {
+			City(const CityGrid& grid, int queue_capacity, DispatchEventSink* sink) :
+				dispatcher_(grid), queue_(queue_capacity), sink_(sink), home_worker_(0), failed_(false) {}
+			Dispatcher dispatcher_;
+			RequestQueue queue_;
+			DispatchEventSink* sink_;
+			int home_worker_;
+			LatencyRecorder tick_latency_;
+			bool failed_;
+			string failure_info_;
+		};
+
+		/// @brief Steps @p city once, marking it failed instead if the step throws.
+		void step_city(City& city);
+
+		struct Worker {
+			thread thread_;
+			mutex mutex_;
+			/// City indices. The owner pops from the back, thieves from the front.
+			deque<int> tasks_;
+			long long num_tasks_ = 0;
+			long long num_steals_ = 0;
+		};
+
+		void run_worker(int worker_index);
+
+		/// @brief Takes the next task for @p worker_index, stealing if its own deque is empty.
+		/// @return The city index, or -1 if no worker has a task left.
+		int take_task(int worker_index);
+
+		vector<unique_ptr<City>> cities_;
+		vector<unique_ptr<Worker>> workers_;
+		/// Cities stepped in the current round, kept to reuse its buffer.
+		vector<int> round_cities_;
+
+		/// Guards round_ and stopping_, and pairs with the condition variables below.
+		mutex mutex_;
+		condition_variable round_started_;
+		condition_variable round_finished_;
+		long long round_;
+		bool stopping_;
+		/// Tasks in the current round that have not finished yet.
+		atomic<int> tasks_remaining_;
+	};
+
+}  // namespace ride_share
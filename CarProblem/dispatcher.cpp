@@ -2,55 +2,195 @@
  * @file dispatcher.cpp
  * @author Ryan McMahon (mcmahonryan@hotmail.com)
  */
+#include <algorithm>
 #include "dispatcher.h"
 
 namespace ride_share {
 
-	Dispatcher::Dispatcher() {
+	/// Compaction is skipped until at least this many roster slots are free.
+	static const int kMinCompactionSlots = 64;
+
+	/// The ETA plan gives up after this many steps per active passenger per block of the city's
+	/// longest trip, which is far beyond what the heuristic needs to serve everyone.
+	static const int kPlanStepsPerRiderBlock = 4;
+
+	Dispatcher::Dispatcher(const CityGrid& grid, pmr::memory_resource* resource) :
+		resource_(resource),
+		grid_(grid),
+		goal_board_(grid),
+		passenger_roster_(resource),
+		passenger_name_map_(resource),
+		free_ids_(resource),
+		retirement_queue_(resource),
+		deferred_requests_(resource),
+		active_passengers_(resource),
+		active_trips_(resource),
+		passengers_in_car_(resource),
+		plan_passengers_(resource),
+		plan_ids_(resource),
+		plan_pickup_times_(resource),
+		plan_dropoff_times_(resource),
+		bulk_eta_goals_(resource),
+		bulk_eta_dists_(resource)
+	{
+		use_goal_board_ = SmallCityBoard<kSmallCityMaxCells>::fits(grid);
 		last_request_made_ = false;
 		new_request_made_ = false;
-		next_passenger_ = nullptr;
+		next_passenger_index_ = -1;
+		snapshot_publisher_ = nullptr;
+		request_queue_ = nullptr;
+		num_queued_requests_accepted_ = 0;
+		num_queued_requests_rejected_ = 0;
 		average_unhappiness_ = 0.0;
 		average_trip_time_ = 0.0;
 		num_trips_completed_ = 0;
+		current_time_ = 0;
+		idle_retirement_steps_ = -1;
+		stable_ordering_ = true;
+		retirement_queue_head_ = 0;
+		deferred_requests_head_ = 0;
+		num_admitted_this_tick_ = 0;
+		num_requests_admitted_ = 0;
+		num_requests_deferred_ = 0;
+		num_requests_rejected_ = 0;
+		num_roster_entries_ = 0;
+		next_generation_ = 0;
+		plan_valid_ = false;
+		num_plans_built_ = 0;
+		publish_car_state();
+	}
+
+	Dispatcher::~Dispatcher() {
+		for (size_t i = 0; i < passenger_roster_.size(); i++) {
+			if (passenger_roster_[i]) {
+				delete_object(passenger_roster_[i]);
+			}
+		}
+	}
+
+	template <class T, class... Args>
+	T* Dispatcher::new_object(Args&&... args) {
+		pmr::polymorphic_allocator<T> allocator(resource_);
+		T* object = allocator.allocate(1);
+		try {
+			allocator.construct(object, std::forward<Args>(args)...);
+		}
+		catch (...) {
+			allocator.deallocate(object, 1);
+			throw;
+		}
+		return object;
+	}
+
+	template <class T>
+	void Dispatcher::delete_object(T* object) {
+		pmr::polymorphic_allocator<T> allocator(resource_);
+		object->~T();
+		allocator.deallocate(object, 1);
 	}
 
+	/// @brief Sink that collects pickups and drop-offs into caller-owned vectors.
+	class VectorEventSink : public DispatchEventSink {
+	public:
+		VectorEventSink(vector<PassengerData*>& picked_up, vector<PassengerData*>& dropped_off) :
+			picked_up_(picked_up),
+			dropped_off_(dropped_off)
+		{
+		}
+		void on_pickup(PassengerData* passenger) override { picked_up_.push_back(passenger); }
+		void on_drop_off(PassengerData* passenger) override { dropped_off_.push_back(passenger); }
+	private:
+		vector<PassengerData*>& picked_up_;
+		vector<PassengerData*>& dropped_off_;
+	};
+
 	void Dispatcher::update(vector<PassengerData*>& ret_passengers_picked_up, vector<PassengerData*>& ret_passengers_dropped_off) {
+		VectorEventSink sink(ret_passengers_picked_up, ret_passengers_dropped_off);
+		update(sink);
+	}
+
+	void Dispatcher::update() {
+		DispatchEventSink sink;
+		update(sink);
+	}
+
+	void Dispatcher::update(DispatchEventSink& sink) {
+
+		// Retire before anything else, so passengers handed out by the previous step stay valid until now.
+		retire_idle_passengers();
+
+		// A new intake window opens with each step. Deferred requests get it first, so queued and direct
+		// requests can't overtake them.
+		num_admitted_this_tick_ = 0;
+		if (deferred_requests_head_ < deferred_requests_.size()) {
+			admit_deferred_requests();
+		}
+
+		if (request_queue_) {
+			drain_request_queue();
+		}
 
 		// Move the car. If there are active passengers, it should always have a goal.
-		if (next_passenger_) {
-			Point car_goal = next_passenger_->get_car_goal();
+		if (next_passenger_index_ >= 0) {
+			Point car_goal = active_passengers_[next_passenger_index_].get_car_goal();
 			car_.update(&car_goal);
 		}
 		else {
 			car_.update(nullptr);
 		}
+		current_time_++;
+		sink.on_car_moved(car_.pos_, current_time_);
 
-		// Update all passengers in transit. Drop-offs are deleted.
-		vector<Passenger*> new_passenger_list;
+		// Update all passengers in transit. Drop-offs are removed in place, so a step without
+		// drop-offs never touches the allocator.
+		// Elapsed times come from the clock, so when the board shows no goal under the car, nothing
+		// can happen to any passenger this step and the scan is skipped.
 		bool change_occurred = false;
-		for (vector<Passenger*>::iterator it = active_passengers_.begin(); it != active_passengers_.end(); it++) {
-			Passenger* p = *it;
-			bool status_change = p->update(car_.pos_);
-			if (status_change) { change_occurred = true; }
+		size_t write_index = 0;
+		size_t read_index = 0;
+		if (use_goal_board_ && !goal_board_.has_goal_at(car_.pos_)) {
+			read_index = active_passengers_.size();
+			write_index = read_index;
+		}
+		while (read_index < active_passengers_.size()) {
+			PassengerEvent event = active_passengers_[read_index].update(car_.pos_, current_time_);
+			if (event != PassengerEvent::None) { change_occurred = true; }
+
+			PassengerData* data = active_trips_[read_index].data_;
+			if (event == PassengerEvent::PickedUp) {
+				if (use_goal_board_) {
+					const Passenger& p = active_passengers_[read_index];
+					goal_board_.remove(BoardLayer::Pickups, p.get_start());
+					goal_board_.remove(BoardLayer::DropOffs, p.get_end());
+					goal_board_.add(BoardLayer::InCarDestinations, p.get_end());
+				}
+				passengers_in_car_.push_back(data);
+				sink.on_pickup(data);
+			}
 
-			if (status_change && p->is_picked_up() && !p->dropped_off_) {
-				ret_passengers_picked_up.push_back(p->data_);
+			if (event != PassengerEvent::DroppedOff) {
+				if (stable_ordering_) {
+					move_active_passenger(read_index, write_index++);
+				}
+				read_index++;
+				continue;
 			}
 
-			if (p->dropped_off_) {
-				ret_passengers_dropped_off.push_back(p->data_);
-				active_passenger_map_.erase(p->data_->id_);
-				average_unhappiness_ = (average_unhappiness_ * (float)num_trips_completed_ + p->get_unhappiness_score()) / ((float)(num_trips_completed_ + 1));
-				average_trip_time_ = (average_trip_time_ * (float)num_trips_completed_ + p->time_elapsed_) / ((float)(num_trips_completed_ + 1));
-				num_trips_completed_++;
-				delete p;
+			complete_trip(read_index, sink);
+			if (stable_ordering_) {
+				read_index++;
 			}
 			else {
-				new_passenger_list.push_back(p);
+				// Swap-remove: the last passenger takes this slot and is updated on the next iteration.
+				move_active_passenger(active_passengers_.size() - 1, read_index);
+				active_passengers_.pop_back();
+				active_trips_.pop_back();
 			}
 		}
-		active_passengers_ = new_passenger_list;
+		if (stable_ordering_) {
+			active_passengers_.resize(write_index);
+			active_trips_.resize(write_index);
+		}
 
 		if (new_request_made_) {
 			change_occurred = true;
@@ -59,66 +199,392 @@ namespace ride_share {
 
 		// If a state change occurred, recalculate which passenger to serve next.
 		if (change_occurred) {
-			float lowest_systemic_score = 10000000.0f;
-			Passenger* lowest_systemic_score_passenger = nullptr;
-			for (vector<Passenger*>::iterator it = active_passengers_.begin(); it != active_passengers_.end(); it++) {
-				Passenger* p = *it;
-				float systemic_unhappiness_score = get_total_unhappiness_score(*p);
-				if (systemic_unhappiness_score < lowest_systemic_score) {
-					lowest_systemic_score = systemic_unhappiness_score;
-					lowest_systemic_score_passenger = p;
-				}
-			}
-			next_passenger_ = lowest_systemic_score_passenger;
+			next_passenger_index_ = choose_next_passenger(active_passengers_, car_.pos_, current_time_);
+		}
+
+		publish_car_state();
+		if (snapshot_publisher_) {
+			snapshot_publisher_->publish(*this);
+		}
+	}
+
+	void Dispatcher::write_snapshot(DispatcherSnapshot& snapshot) const {
+		snapshot.clear();
+		snapshot.time_ = current_time_;
+		snapshot.car_pos_ = car_.pos_;
+		snapshot.has_car_goal_ = (next_passenger_index_ >= 0);
+		if (snapshot.has_car_goal_) {
+			snapshot.car_goal_ = active_passengers_[next_passenger_index_].get_car_goal();
+		}
+		snapshot.num_trips_completed_ = num_trips_completed_;
+		for (size_t i = 0; i < active_passengers_.size(); i++) {
+			const Passenger& p = active_passengers_[i];
+			PassengerData* data = active_trips_[i].data_;
+			const pmr::string& name = data->get_name();
+			snapshot.add_rider(data->get_handle(), string_view(name.data(), name.size()), p.get_start(), p.get_end(), p.is_picked_up());
+		}
+	}
+
+	void Dispatcher::complete_trip(size_t index, DispatchEventSink& sink) {
+		const Passenger& p = active_passengers_[index];
+		TripRecord& trip = active_trips_[index];
+		PassengerData* data = trip.data_;
+
+		if (use_goal_board_) {
+			goal_board_.remove(BoardLayer::InCarDestinations, p.get_end());
+		}
+		passengers_in_car_.erase(find(passengers_in_car_.begin(), passengers_in_car_.end(), data));
+		sink.on_drop_off(data);
+		int trip_time = current_time_ - trip.request_time_;
+		average_unhappiness_ = (average_unhappiness_ * (float)num_trips_completed_ + p.get_unhappiness_score(current_time_)) / ((float)(num_trips_completed_ + 1));
+		average_trip_time_ = (average_trip_time_ * (float)num_trips_completed_ + trip_time) / ((float)(num_trips_completed_ + 1));
+		num_trips_completed_++;
+		data->active_index_ = -1;
+		data->last_active_time_ = current_time_;
+		if (idle_retirement_steps_ >= 0) {
+			RetirementEntry entry = { data->get_handle(), current_time_ };
+			retirement_queue_.push_back(entry);
+		}
+	}
+
+	void Dispatcher::move_active_passenger(size_t from_index, size_t to_index) {
+		if (from_index == to_index) {
+			return;
+		}
+		active_passengers_[to_index] = active_passengers_[from_index];
+		active_trips_[to_index] = active_trips_[from_index];
+		active_trips_[to_index].data_->active_index_ = (int)to_index;
+	}
+
+	void Dispatcher::publish_car_state() {
+		Point goal;
+		if (next_passenger_index_ >= 0) {
+			goal = active_passengers_[next_passenger_index_].get_car_goal();
 		}
+		car_state_.store(CarState(current_time_, car_.pos_, next_passenger_index_ >= 0, goal));
 	}
 
 	bool Dispatcher::is_done() {
+		if (request_queue_ && !request_queue_->is_empty()) {
+			return false;
+		}
+		if (deferred_requests_head_ < deferred_requests_.size()) {
+			return false;
+		}
 		return (last_request_made_ && active_passengers_.size() == 0);
 	}
 
-	void Dispatcher::get_passengers_in_car(vector<PassengerData*>& ret_list) {
-		for (vector<Passenger*>::iterator it = active_passengers_.begin(); it != active_passengers_.end(); it++) {
-			Passenger* p = *it;
-			if (p->is_picked_up()) {
-				ret_list.push_back(p->data_);
+	void Dispatcher::drain_request_queue() {
+		// Producers can refill the queue as fast as it empties, so take at most one queue's worth per
+		// step; anything more waits for the next one.
+		RideRequest request;
+		int num_left = request_queue_->get_capacity();
+		while (num_left-- > 0 && request_queue_->pop(&request)) {
+			try {
+				AdmissionOutcome outcome = submit_request(request.get_name(), request.get_start_x(), request.get_start_y(), request.get_end_x(), request.get_end_y());
+				if (outcome == AdmissionOutcome::Rejected) {
+					num_queued_requests_rejected_++;
+				}
+				else {
+					num_queued_requests_accepted_++;
+				}
+			}
+			catch (const PassengerException&) {
+				num_queued_requests_rejected_++;
 			}
 		}
 	}
 
-	void Dispatcher::new_request(const char* name, int start_x, int start_y, int end_x, int end_y) {
+	void Dispatcher::get_passengers_in_car(vector<PassengerData*>& ret_list) {
+		ret_list.insert(ret_list.end(), passengers_in_car_.begin(), passengers_in_car_.end());
+	}
+
+	PassengerHandle Dispatcher::new_request(const char* name, int start_x, int start_y, int end_x, int end_y) {
+		PassengerHandle handle;
+		if (submit_request(name, start_x, start_y, end_x, end_y, &handle) == AdmissionOutcome::Rejected) {
+			string info = "Request from " + string(name) + " rejected: too many requests waiting for admission";
+			PassengerException e(info);
+			throw e;
+		}
+		return handle;
+	}
+
+	AdmissionOutcome Dispatcher::submit_request(const char* name, int start_x, int start_y, int end_x, int end_y, PassengerHandle* ret_handle) {
 		PassengerData* data = get_passenger_data(name);
+		Point start(start_x, start_y);
+		Point end(end_x, end_y);
+		validate_request(data, start, end);
+
+		// Decide before interning the name, so invalid and rejected requests leave nothing in the roster.
+		bool admit = (deferred_requests_head_ == deferred_requests_.size() && can_admit());
+		if (!admit && admission_policy_.get_max_deferred() >= 0 && get_num_deferred() >= admission_policy_.get_max_deferred()) {
+			num_requests_rejected_++;
+			return AdmissionOutcome::Rejected;
+		}
 		if (!data) {
 			make_passenger(name);
 			data = get_passenger_data(name);
 		}
-		Point start(start_x, start_y);
-		Point end(end_x, end_y);
-		activate_passenger(data->id_, start, end);
+
+		AdmissionOutcome outcome;
+		if (admit) {
+			activate_passenger(data->id_, start, end, current_time_);
+			num_admitted_this_tick_++;
+			num_requests_admitted_++;
+			outcome = AdmissionOutcome::Admitted;
+		}
+		else {
+			DeferredRequest request = { data, start, end, current_time_ };
+			deferred_requests_.push_back(request);
+			data->deferred_ = true;
+			num_requests_deferred_++;
+			outcome = AdmissionOutcome::Deferred;
+		}
+		if (ret_handle) {
+			*ret_handle = data->get_handle();
+		}
+		return outcome;
+	}
+
+	bool Dispatcher::can_admit() {
+		int max_intake = admission_policy_.get_max_intake_per_tick();
+		int max_active = admission_policy_.get_max_active();
+		return (max_intake < 0 || num_admitted_this_tick_ < max_intake) && (max_active < 0 || (int)active_passengers_.size() < max_active);
+	}
+
+	void Dispatcher::admit_deferred_requests() {
+		while (deferred_requests_head_ < deferred_requests_.size() && can_admit()) {
+			DeferredRequest& request = deferred_requests_[deferred_requests_head_];
+			request.data_->deferred_ = false;
+			activate_passenger(request.data_->id_, request.start_, request.end_, request.request_time_);
+			num_admitted_this_tick_++;
+			num_requests_admitted_++;
+			deferred_requests_head_++;
+		}
+		// Same reclamation as the retirement queue: the buffer is reused once the queue has drained enough.
+		if (deferred_requests_head_ * 2 >= deferred_requests_.size()) {
+			deferred_requests_.erase(deferred_requests_.begin(), deferred_requests_.begin() + deferred_requests_head_);
+			deferred_requests_head_ = 0;
+		}
 	}
 
 	bool Dispatcher::is_passenger_active(const char* name) {
 		PassengerData* data = get_passenger_data(name);
-		if (data) {
-			if (active_passenger_map_.find(data->id_) != active_passenger_map_.end()) {
-				return true;
+		return (data && data->active_index_ >= 0);
+	}
+
+	void Dispatcher::make_passenger(const char* name) {
+		if (get_passenger_data(name)) {
+			return;
+		}
+		int new_id;
+		if (free_ids_.size() > 0) {
+			new_id = free_ids_.back();
+			free_ids_.pop_back();
+		}
+		else {
+			new_id = passenger_roster_.size();
+			passenger_roster_.push_back(nullptr);
+		}
+		PassengerData* data = new_object<PassengerData>(name, new_id, next_generation_++, resource_);
+		passenger_roster_[new_id] = data;
+		passenger_name_map_.emplace(name, data);
+		num_roster_entries_++;
+	}
+
+	bool Dispatcher::is_handle_current(const PassengerHandle& handle) {
+		PassengerData* data = get_passenger_data(handle.id());
+		return (data && data->generation_ == handle.generation());
+	}
+
+	PassengerData* Dispatcher::get_active_passenger_data(const PassengerHandle& handle) {
+		PassengerData* data = get_passenger_data(handle.id());
+		if (!data || data->generation_ != handle.generation() || data->active_index_ < 0) {
+			return nullptr;
+		}
+		return data;
+	}
+
+	int Dispatcher::estimate_pickup(const PassengerHandle& handle) {
+		PassengerData* data = get_active_passenger_data(handle);
+		if (!data) {
+			return -1;
+		}
+		// Pickups don't invalidate the plan, so its pickup time for a rider already aboard is stale.
+		if (active_passengers_[data->active_index_].is_picked_up()) {
+			return -1;
+		}
+		if (!plan_valid_) {
+			build_plan();
+		}
+		return plan_pickup_times_[data->id_];
+	}
+
+	int Dispatcher::estimate_dropoff(const PassengerHandle& handle) {
+		PassengerData* data = get_active_passenger_data(handle);
+		if (!data) {
+			return -1;
+		}
+		if (!plan_valid_) {
+			build_plan();
+		}
+		return plan_dropoff_times_[data->id_];
+	}
+
+	bool Dispatcher::estimate_all_next_stops(int* ret_etas) {
+		fill(ret_etas, ret_etas + passenger_roster_.size(), -1);
+		size_t count = active_passengers_.size();
+		if (plan_valid_) {
+			for (size_t i = 0; i < count; i++) {
+				int id = active_trips_[i].id_;
+				ret_etas[id] = active_passengers_[i].is_picked_up() ? plan_dropoff_times_[id] : plan_pickup_times_[id];
 			}
+			return true;
+		}
+		if (count == 0) {
+			return false;
+		}
+
+		// Every passenger is reached from the end of the current leg, so the leg itself is one constant.
+		Point leg_end = next_passenger_index_ >= 0 ? active_passengers_[next_passenger_index_].get_car_goal() : car_.pos_;
+		int leg_end_time = current_time_ + Point::get_dist(car_.pos_, leg_end);
+		bulk_eta_goals_.resize(count);
+		bulk_eta_dists_.resize(count);
+		for (size_t i = 0; i < count; i++) {
+			bulk_eta_goals_[i] = active_passengers_[i].get_car_goal().pack();
+		}
+		Point::get_dist_packed(bulk_eta_goals_.data(), (int)count, leg_end.pack(), bulk_eta_dists_.data());
+		for (size_t i = 0; i < count; i++) {
+			ret_etas[active_trips_[i].id_] = leg_end_time + bulk_eta_dists_[i];
 		}
 		return false;
 	}
 
-	void Dispatcher::make_passenger(const char* name) {
-		if (get_passenger_data(name)) {
+	void Dispatcher::build_plan() {
+		// Mirrors update() without the side effects: same car movement, same passenger updates, same
+		// removal order, and the same scoring at the same moments, so the plan is what update() will do.
+		plan_passengers_.assign(active_passengers_.begin(), active_passengers_.end());
+		plan_ids_.clear();
+		for (size_t i = 0; i < active_trips_.size(); i++) {
+			plan_ids_.push_back(active_trips_[i].id_);
+		}
+		plan_pickup_times_.assign(passenger_roster_.size(), -1);
+		plan_dropoff_times_.assign(passenger_roster_.size(), -1);
+
+		Car car = car_;
+		int now = current_time_;
+		int next_index = next_passenger_index_;
+		bool change_pending = new_request_made_;
+		long long horizon = (long long)(plan_passengers_.size() + 1) * (grid_.get_max_dist() + 1) * kPlanStepsPerRiderBlock;
+		for (long long step = 0; step < horizon && !plan_passengers_.empty(); step++) {
+			if (next_index >= 0) {
+				Point car_goal = plan_passengers_[next_index].get_car_goal();
+				car.update(&car_goal);
+			}
+			else {
+				car.update(nullptr);
+			}
+			now++;
+
+			bool change_occurred = change_pending;
+			change_pending = false;
+			size_t write_index = 0;
+			size_t read_index = 0;
+			while (read_index < plan_passengers_.size()) {
+				PassengerEvent event = plan_passengers_[read_index].update(car.pos_, now);
+				if (event != PassengerEvent::None) { change_occurred = true; }
+				if (event == PassengerEvent::PickedUp) {
+					plan_pickup_times_[plan_ids_[read_index]] = now;
+				}
+
+				if (event != PassengerEvent::DroppedOff) {
+					if (stable_ordering_) {
+						plan_passengers_[write_index] = plan_passengers_[read_index];
+						plan_ids_[write_index++] = plan_ids_[read_index];
+					}
+					read_index++;
+					continue;
+				}
+
+				plan_dropoff_times_[plan_ids_[read_index]] = now;
+				if (stable_ordering_) {
+					read_index++;
+				}
+				else {
+					plan_passengers_[read_index] = plan_passengers_.back();
+					plan_ids_[read_index] = plan_ids_.back();
+					plan_passengers_.pop_back();
+					plan_ids_.pop_back();
+				}
+			}
+			if (stable_ordering_) {
+				plan_passengers_.resize(write_index);
+				plan_ids_.resize(write_index);
+			}
+
+			if (change_occurred) {
+				next_index = choose_next_passenger(plan_passengers_, car.pos_, now);
+			}
+		}
+		plan_valid_ = true;
+		num_plans_built_++;
+	}
+
+	void Dispatcher::retire_idle_passengers() {
+		if (idle_retirement_steps_ < 0) {
 			return;
 		}
-		int new_id = passenger_roster_.size();
-		PassengerData* data = new PassengerData(name, new_id);
-		passenger_roster_.push_back(data);
-		passenger_name_map_[name] = data;
+		while (retirement_queue_head_ < retirement_queue_.size()) {
+			RetirementEntry& entry = retirement_queue_[retirement_queue_head_];
+			if (current_time_ - entry.drop_off_time_ < idle_retirement_steps_) {
+				break;
+			}
+			// Skip passengers that were already retired, have since requested another ride (active or
+			// deferred), or were dropped off again later (a newer entry further back covers that drop-off).
+			PassengerData* data = get_passenger_data(entry.handle_.id());
+			if (data && data->generation_ == entry.handle_.generation() && data->last_active_time_ == entry.drop_off_time_
+				&& data->active_index_ < 0 && !data->deferred_) {
+				retire_passenger(data);
+			}
+			retirement_queue_head_++;
+		}
+		// Reclaim the consumed front in place once it makes up half the queue. The capacity is kept,
+		// so a steady stream of drop-offs stops allocating once the queue has reached its working size.
+		if (retirement_queue_head_ * 2 >= retirement_queue_.size()) {
+			retirement_queue_.erase(retirement_queue_.begin(), retirement_queue_.begin() + retirement_queue_head_);
+			retirement_queue_head_ = 0;
+		}
+	}
+
+	void Dispatcher::retire_passenger(PassengerData* data) {
+		passenger_name_map_.erase(data->name_);
+		passenger_roster_[data->id_] = nullptr;
+		free_ids_.push_back(data->id_);
+		num_roster_entries_--;
+		delete_object(data);
+
+		int num_free = free_ids_.size();
+		if (num_free >= kMinCompactionSlots && num_free > num_roster_entries_) {
+			compact_roster();
+		}
+	}
+
+	void Dispatcher::compact_roster() {
+		while (passenger_roster_.size() > 0 && passenger_roster_.back() == nullptr) {
+			passenger_roster_.pop_back();
+		}
+		free_ids_.clear();
+		for (int id = (int)passenger_roster_.size() - 1; id >= 0; id--) {
+			if (passenger_roster_[id] == nullptr) {
+				free_ids_.push_back(id);
+			}
+		}
+		passenger_roster_.shrink_to_fit();
+		free_ids_.shrink_to_fit();
 	}
 
 	PassengerData* Dispatcher::get_passenger_data(const char* name) {
-		map<string, PassengerData*>::iterator it = passenger_name_map_.find(name);
+		pmr::map<pmr::string, PassengerData*, less<>>::iterator it = passenger_name_map_.find(name);
 		if (it != passenger_name_map_.end()) {
 			return it->second;
 		}
@@ -132,45 +598,79 @@ namespace ride_share {
 		return passenger_roster_[id];
 	}
 
-	void Dispatcher::activate_passenger(int id, const Point& start, const Point& end) {
-		PassengerData* data = get_passenger_data(id);
-		if (!data) {
-			PassengerException e;
-			e.passenger_not_found(id);
-			throw e;
-		}
+	void Dispatcher::validate_request(PassengerData* data, const Point& start, const Point& end) {
 		if (start == end) {
 			string info = "Start position " + start.get_string() + " same as end position " + end.get_string();
 			PassengerException e(info);
 			throw e;
 		}
-		if (get_active_passenger(id)) {
-			string info = "Active passenger " + std::to_string(id) + " already exists";
+		if (data && data->active_index_ >= 0) {
+			string info = "Active passenger " + std::to_string(data->id_) + " already exists";
+			PassengerException e(info);
+			throw e;
+		}
+		if (data && data->deferred_) {
+			string info = "Passenger " + std::to_string(data->id_) + " already has a deferred request";
 			PassengerException e(info);
 			throw e;
 		}
-		Passenger* passenger = new Passenger(data);
-		passenger->activate(start, end);
-		passenger->compute_ideal_times(car_.pos_);
+		PassengerException e;
+		if (!grid_.contains(start)) {
+			e.out_of_range(start.x(), start.y(), "start");
+			throw e;
+		}
+		if (!grid_.contains(end)) {
+			e.out_of_range(end.x(), end.y(), "end");
+			throw e;
+		}
+	}
+
+	void Dispatcher::activate_passenger(int id, const Point& start, const Point& end, int request_time) {
+		PassengerData* data = get_passenger_data(id);
+		if (!data) {
+			PassengerException e;
+			e.passenger_not_found(id);
+			throw e;
+		}
+		validate_request(data, start, end);
+		Passenger passenger;
+		passenger.activate(start, end, request_time, grid_);
+		passenger.compute_ideal_times(car_.pos_);
+		TripRecord trip = { data, request_time, id };
+		data->active_index_ = (int)active_passengers_.size();
 		active_passengers_.push_back(passenger);
-		active_passenger_map_[data->id_] = passenger;
+		active_trips_.push_back(trip);
+		if (use_goal_board_) {
+			goal_board_.add(BoardLayer::Pickups, start);
+			goal_board_.add(BoardLayer::DropOffs, end);
+		}
+		// Keep room for every active passenger to board, so pickups never allocate during update().
+		if (passengers_in_car_.capacity() < active_passengers_.size()) {
+			passengers_in_car_.reserve(active_passengers_.size() * 2);
+		}
 		new_request_made_ = true;
+		plan_valid_ = false;
 	}
 
-	Passenger* Dispatcher::get_active_passenger(int id) {
-		map<int, Passenger*>::iterator it = active_passenger_map_.find(id);
-		if (it != active_passenger_map_.end()) {
-			return it->second;
+	int Dispatcher::choose_next_passenger(const pmr::vector<Passenger>& passengers, const Point& car_pos, int now) {
+		float lowest_systemic_score = 10000000.0f;
+		int lowest_systemic_score_index = -1;
+		for (size_t i = 0; i < passengers.size(); i++) {
+			float systemic_unhappiness_score = get_total_unhappiness_score(passengers[i], passengers, car_pos, now);
+			if (systemic_unhappiness_score < lowest_systemic_score) {
+				lowest_systemic_score = systemic_unhappiness_score;
+				lowest_systemic_score_index = (int)i;
+			}
 		}
-		return nullptr;
+		return lowest_systemic_score_index;
 	}
 
-	float Dispatcher::get_total_unhappiness_score(const Passenger& target_passenger) {
-		int time_delta = Point::get_dist(car_.pos_, target_passenger.get_car_goal());
+	float Dispatcher::get_total_unhappiness_score(const Passenger& target_passenger, const pmr::vector<Passenger>& passengers, const Point& car_pos, int now) {
+		Point target_goal = target_passenger.get_car_goal();
+		int time_delta = Point::get_dist(car_pos, target_goal);
 		float total_score = 0.0f;
-		for (vector<Passenger*>::iterator it = active_passengers_.begin(); it != active_passengers_.end(); it++) {
-			Passenger* p = *it;
-			total_score += p->predict_unhappiness_score(target_passenger.get_car_goal(), time_delta);
+		for (size_t i = 0; i < passengers.size(); i++) {
+			total_score += passengers[i].predict_unhappiness_score(target_goal, now, time_delta);
 		}
 		return total_score;
 	}
@@ -7,12 +7,69 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <memory_resource>
 #include "point.h"
 #include "passenger.h"
 #include "car.h"
+#include "city_grid.h"
+#include "small_city_board.h"
+#include "dispatcher_snapshot.h"
+#include "request_queue.h"
+#include "car_state.h"
+#include "admission_policy.h"
 
 namespace ride_share {
 
+	/// @brief List of passengers, allocated from the owning dispatcher's memory resource.
+	typedef pmr::vector<PassengerData*> PassengerList;
+
+	/// @brief Receives the events produced by Dispatcher::update().
+	///
+	/// Callbacks run synchronously inside update(): on_car_moved() once per step, then on_pickup() and
+	/// on_drop_off() for each passenger as the step reaches them. The default implementations ignore
+	/// the event, so a sink only overrides what it needs.
+	class DispatchEventSink {
+	public:
+		virtual ~DispatchEventSink() {}
+
+		/// @brief Called after the car has moved (or stayed put) for this step.
+		/// @param time The dispatcher's clock after the step; pickups and drop-offs that follow happen at this time.
+		virtual void on_car_moved(const Point& car_pos, int time) {}
+
+		/// @brief Called when @p passenger boards the car.
+		virtual void on_pickup(PassengerData* passenger) {}
+
+		/// @brief Called when @p passenger is dropped off.
+		virtual void on_drop_off(PassengerData* passenger) {}
+	};
+
+	/// @brief Forwards every event to each of several sinks, in the order they were added, so more
+	///        than one consumer can watch the same dispatcher.
+	class FanOutEventSink : public DispatchEventSink {
+	public:
+		/// @brief Adds @p sink, which must outlive this one.
+		void add(DispatchEventSink* sink) { sinks_.push_back(sink); }
+
+		void on_car_moved(const Point& car_pos, int time) override {
+			for (DispatchEventSink* sink : sinks_) {
+				sink->on_car_moved(car_pos, time);
+			}
+		}
+		void on_pickup(PassengerData* passenger) override {
+			for (DispatchEventSink* sink : sinks_) {
+				sink->on_pickup(passenger);
+			}
+		}
+		void on_drop_off(PassengerData* passenger) override {
+			for (DispatchEventSink* sink : sinks_) {
+				sink->on_drop_off(passenger);
+			}
+		}
+
+	private:
+		vector<DispatchEventSink*> sinks_;
+	};
+
 	/// @brief Manages the vehicle and all passengers, applying an unhappiness-minimizing
 	///        heuristic to decide which passenger to serve next.
 	///
@@ -20,7 +77,28 @@ namespace ride_share {
 	/// See README.md for a high-level description of the heuristic.
 	class Dispatcher {
 	public:
-		Dispatcher();
+		/// @brief Cities with at most this many intersections (two 64-bit words) are tracked with bitboards.
+		static const int kSmallCityMaxCells = 128;
+
+		/// @brief Creates a dispatcher for @p grid whose per-simulation memory all comes from @p resource.
+		///
+		/// The dispatcher keeps its own copy of @p grid and shares no state with other dispatchers.
+		/// Roster entries, names, map nodes and passengers are allocated from @p resource, which must
+		/// outlive the dispatcher. Passing a SimulationArena's resource lets a batch of short simulations
+		/// share one buffer that is released in a single reset between runs.
+		explicit Dispatcher(const CityGrid& grid, pmr::memory_resource* resource = pmr::get_default_resource());
+		~Dispatcher();
+		Dispatcher(const Dispatcher&) = delete;
+		Dispatcher& operator=(const Dispatcher&) = delete;
+
+		/// @brief Advances the simulation one time step, reporting what happened to @p sink.
+		///
+		/// Once no new requests arrive and the active passengers have been seen, a step performs no
+		/// heap allocations of its own; any allocation comes from the sink.
+		void update(DispatchEventSink& sink);
+
+		/// @brief Advances the simulation one time step, discarding the events.
+		void update();
 
 		/// @brief Advances the simulation one time step.
 		/// @param ret_passengers_picked_up Populated with passengers picked up this step.
@@ -28,24 +106,75 @@ namespace ride_share {
 		void update(vector<PassengerData*>& ret_passengers_picked_up, vector<PassengerData*>& ret_passengers_dropped_off);
 
 		/// @brief Returns true when all passengers have been served and no new requests are coming.
+		///
+		/// Deferred requests must also have been served, and with a request queue attached, the queue
+		/// must have been drained.
 		bool is_done();
 
 		/// @brief Signals that the last ride request has already been submitted.
 		void set_last_request_made() { last_request_made_ = true; }
 
-		/// @brief Returns the car's current grid position.
+		/// @brief Returns the city this dispatcher operates on.
+		const CityGrid& get_grid() const { return grid_; }
+
+		/// @brief Returns the goal bitboard, or nullptr if the city is too large for one.
+		const SmallCityBoard<kSmallCityMaxCells>* get_goal_board() const { return use_goal_board_ ? &goal_board_ : nullptr; }
+
+		/// @brief Returns the car's current grid position. Only for the thread that calls update().
 		Point get_car_pos() { return car_.pos_; }
 
-		/// @brief Populates @p ret_list with passengers currently riding in the car.
+		/// @brief Returns the car's position and goal as of the end of the latest step.
+		///
+		/// Safe to call from any thread, as often as needed, while update() runs on another; it never
+		/// blocks the update thread.
+		CarState get_car_state() const { return car_state_.load(); }
+
+		/// @brief Returns the passengers currently riding in the car, in boarding order.
+		///
+		/// The list is maintained on pickup and drop-off, so this costs nothing per call. It changes
+		/// during update(); copy it first if it must outlive the next step.
+		const PassengerList& get_passengers_in_car() const { return passengers_in_car_; }
+
+		/// @brief Appends the passengers currently riding in the car to @p ret_list.
 		void get_passengers_in_car(vector<PassengerData*>& ret_list);
 
-		/// @brief Submits a new ride request.
+		/// @brief Submits a new ride request, subject to the admission policy.
+		///
+		/// Throws PassengerException if the request is invalid (bad coordinates, or a passenger who already
+		/// has an active or deferred ride) or if the admission policy rejects it; use submit_request() to
+		/// tell those apart. With the default policy every valid request is admitted at once.
 		/// @param name Passenger name (used as the unique identifier).
 		/// @param start_x Pickup x coordinate.
 		/// @param start_y Pickup y coordinate.
 		/// @param end_x Drop-off x coordinate.
 		/// @param end_y Drop-off y coordinate.
-		void new_request(const char* name, int start_x, int start_y, int end_x, int end_y);
+		/// @return Handle to the requesting passenger.
+		PassengerHandle new_request(const char* name, int start_x, int start_y, int end_x, int end_y);
+
+		/// @brief Submits a new ride request and reports what the admission policy did with it.
+		///
+		/// Invalid requests still throw PassengerException. A deferred request is checked now and admitted
+		/// by a later update(); its trip time and unhappiness count from this call, not from admission.
+		/// Only admitted and deferred requests add a new name to the roster.
+		/// @param ret_handle If not null, receives the passenger's handle unless the request is rejected.
+		AdmissionOutcome submit_request(const char* name, int start_x, int start_y, int end_x, int end_y, PassengerHandle* ret_handle = nullptr);
+
+		/// @brief Replaces the admission policy. Requests already deferred stay queued, even past a smaller
+		///        deferred limit, and are admitted under the new limits.
+		void set_admission_policy(const AdmissionPolicy& policy) { admission_policy_ = policy; }
+		const AdmissionPolicy& get_admission_policy() const { return admission_policy_; }
+
+		/// @brief Returns how many requests were admitted (at once or after deferral), deferred, and rejected.
+		///
+		/// A deferred request that is later admitted counts under both. Invalid requests are not counted.
+		void get_admission_statistics(long long* ret_num_admitted, long long* ret_num_deferred, long long* ret_num_rejected) {
+			*ret_num_admitted = num_requests_admitted_;
+			*ret_num_deferred = num_requests_deferred_;
+			*ret_num_rejected = num_requests_rejected_;
+		}
+
+		/// @brief Returns the number of requests waiting in the deferred queue.
+		int get_num_deferred() const { return (int)(deferred_requests_.size() - deferred_requests_head_); }
 
 		/// @brief Returns aggregate statistics for all completed trips.
 		/// @param ret_num_trips Total trips completed.
@@ -60,30 +189,232 @@ namespace ride_share {
 		/// @brief Returns true if the named passenger currently has an active ride.
 		bool is_passenger_active(const char* name);
 
+		/// @brief Retires passengers once they have been idle for @p idle_steps time steps after a drop-off.
+		///
+		/// A retired passenger is forgotten entirely: the roster slot is recycled, and a later request
+		/// under the same name creates a fresh record with a new handle. A negative value (the default)
+		/// keeps every passenger for the life of the dispatcher.
+		void set_idle_retirement(int idle_steps) { idle_retirement_steps_ = idle_steps; }
+
+		/// @brief Chooses how drop-offs are removed from the active passenger list.
+		///
+		/// Stable ordering (the default) compacts the list and keeps passengers in request order, which
+		/// matters because ties in the next-passenger choice go to whoever comes first. Unstable ordering
+		/// swap-removes instead: still deterministic for a given input, but the order, and therefore
+		/// tie-breaking, differs.
+		void set_stable_ordering(bool stable) { stable_ordering_ = stable; plan_valid_ = false; }
+
+		/// @brief Publishes a snapshot to @p publisher at the end of every step, for readers on other threads.
+		///
+		/// Pass nullptr to stop publishing. The publisher must outlive the dispatcher or be detached first.
+		void set_snapshot_publisher(SnapshotPublisher* publisher) { snapshot_publisher_ = publisher; }
+
+		/// @brief Drains @p queue at the start of every step, so other threads can submit requests.
+		///
+		/// Queued requests go through submit_request() in the order they were queued. One that is invalid
+		/// (bad coordinates, or a passenger already riding) or rejected by the admission policy is counted
+		/// and dropped, since there is no caller left to report it to. A step takes at most the queue's
+		/// capacity in requests, so producers that never stop can't hold up a step; the rest wait for the
+		/// next one. Pass nullptr to detach. The queue must outlive the dispatcher or be detached first.
+		void set_request_queue(RequestQueue* queue) { request_queue_ = queue; }
+
+		/// @brief Returns how many queued requests were admitted or deferred, and how many were dropped.
+		void get_queue_statistics(long long* ret_num_accepted, long long* ret_num_rejected) {
+			*ret_num_accepted = num_queued_requests_accepted_;
+			*ret_num_rejected = num_queued_requests_rejected_;
+		}
+
+		/// @brief Copies the current state into @p snapshot, reusing its buffers.
+		void write_snapshot(DispatcherSnapshot& snapshot) const;
+
+		/// @brief Returns the number of passengers currently held in the roster.
+		int get_roster_size() { return num_roster_entries_; }
+
+		/// @brief Returns true if @p handle still refers to a passenger in the roster.
+		bool is_handle_current(const PassengerHandle& handle);
+
+		/// @brief Returns the time step at which the passenger will be picked up, if no new requests arrive.
+		///
+		/// The answer comes from a plan made by running the heuristic forward on copies of the car and the
+		/// active passengers, so it accounts for everyone served first. Steps without new requests follow
+		/// the plan exactly, so it is kept until a new request or an ordering change makes it stale, and
+		/// queries in between are O(1). Times are on the same clock as CarState::get_time(). Returns -1 if
+		/// the handle is stale, the passenger has no active ride or is already in the car, or the pickup
+		/// lies beyond the planning horizon. Requests waiting in the admission queue have no active ride
+		/// yet, so they get -1 and are left out of the plan until admitted; the plan is rebuilt then.
+		int estimate_pickup(const PassengerHandle& handle);
+
+		/// @brief Returns the time step at which the passenger will be dropped off, if no new requests arrive.
+		///
+		/// Same plan and rules as estimate_pickup(), except that riders already in the car get an estimate.
+		int estimate_dropoff(const PassengerHandle& handle);
+
+		/// @brief Returns how many times the ETA plan has been rebuilt.
+		int get_num_plans_built() const { return num_plans_built_; }
+
+		/// @brief Returns one more than the highest roster ID in use; arrays indexed by ID need this many entries.
+		int get_roster_id_limit() const { return (int)passenger_roster_.size(); }
+
+		/// @brief Writes an ETA for every active passenger into @p ret_etas, indexed by roster ID: the time
+		///        the car reaches the passenger's next stop, the pickup while waiting or the drop-off once aboard.
+		///
+		/// While the plan behind estimate_pickup() and estimate_dropoff() is current, each entry is read
+		/// from it in one O(n) pass and matches those estimates, -1 beyond the planning horizon included.
+		/// It never builds a plan, though. When the plan is stale, the ETA is the time the car would arrive
+		/// if it finished its current leg and then drove straight there. That holds for the passenger being
+		/// served unless an event on the way changes the car's mind, and is an optimistic guess for
+		/// everyone else; one pass packs the goals and one vectorized distance pass does the rest, so it
+		/// stays cheap with 10^5 riders. Entries for IDs without an active ride are set to -1.
+		/// @p ret_etas must hold get_roster_id_limit() entries.
+		/// @return True if the ETAs came from the plan, false if they are the straight-line fallback.
+		bool estimate_all_next_stops(int* ret_etas);
+
 	private:
 		void make_passenger(const char* name);
 		PassengerData* get_passenger_data(const char* name);
 		PassengerData* get_passenger_data(int id);
 
-		void activate_passenger(int id, const Point& start, const Point& end);
-		Passenger* get_active_passenger(int id);
+		/// @brief Throws PassengerException unless @p data may request a ride from @p start to @p end.
+		///        A null @p data stands for a name not yet in the roster.
+		void validate_request(PassengerData* data, const Point& start, const Point& end);
+
+		/// @brief Starts the ride for passenger @p id, treating it as requested at @p request_time.
+		void activate_passenger(int id, const Point& start, const Point& end, int request_time);
+
+		/// @brief Submits the requests waiting in the attached queue, up to its capacity.
+		void drain_request_queue();
+
+		/// @brief Returns true if the admission policy has room to admit a request right now.
+		bool can_admit();
+
+		/// @brief Admits deferred requests, oldest first, while the policy has room.
+		void admit_deferred_requests();
+
+		/// @brief Publishes the car's position and goal for get_car_state().
+		void publish_car_state();
+
+		/// @brief Returns the roster entry behind @p handle if it is current and has an active ride, else nullptr.
+		PassengerData* get_active_passenger_data(const PassengerHandle& handle);
+
+		/// @brief Simulates ahead until every active passenger is dropped off, recording when each event happens.
+		void build_plan();
 
-		/// @brief Returns the predicted total systemic unhappiness if @p target_passenger is served next.
-		float get_total_unhappiness_score(const Passenger& target_passenger);
+		/// @brief Retires every passenger whose idle period has run out.
+		void retire_idle_passengers();
 
+		/// @brief Removes @p data from the roster and recycles its ID.
+		void retire_passenger(PassengerData* data);
+
+		/// @brief Trims free slots off the end of the roster and rebuilds the free list.
+		void compact_roster();
+
+		/// @brief Records the drop-off of the active passenger at @p index. The caller removes the entry.
+		void complete_trip(size_t index, DispatchEventSink& sink);
+
+		/// @brief Moves the active passenger at @p from_index to @p to_index, overwriting that slot.
+		void move_active_passenger(size_t from_index, size_t to_index);
+
+		/// @brief Returns the index of the passenger with the lowest predicted systemic unhappiness, or -1 if there are none.
+		static int choose_next_passenger(const pmr::vector<Passenger>& passengers, const Point& car_pos, int now);
+
+		/// @brief Returns the predicted total systemic unhappiness of @p passengers if @p target_passenger is served next.
+		static float get_total_unhappiness_score(const Passenger& target_passenger, const pmr::vector<Passenger>& passengers, const Point& car_pos, int now);
+
+		/// @brief Constructs a @p T from the dispatcher's memory resource.
+		template <class T, class... Args> T* new_object(Args&&... args);
+
+		/// @brief Destroys and frees an object made by new_object().
+		template <class T> void delete_object(T* object);
+
+		pmr::memory_resource* resource_;
+		CityGrid grid_;
 		Car car_;
 
-		vector<PassengerData*> passenger_roster_;
-		map<string, PassengerData*> passenger_name_map_;
-		vector<Passenger*> active_passengers_;
-		map<int, Passenger*> active_passenger_map_;
+		/// Pickup and destination cells of the active passengers. Only maintained for small cities, where
+		/// it lets a step skip the passenger scan whenever the car is not standing on a goal.
+		SmallCityBoard<kSmallCityMaxCells> goal_board_;
+		bool use_goal_board_;
 
-		/// The passenger the car is currently heading toward (lowest predicted systemic unhappiness).
-		Passenger* next_passenger_;
+		/// A passenger dropped off at @p drop_off_time_, pending retirement.
+		struct RetirementEntry {
+			PassengerHandle handle_;
+			int drop_off_time_;
+		};
+
+		/// Indexed by passenger ID. Retired slots hold nullptr until reused or compacted away.
+		PassengerList passenger_roster_;
+		/// Transparent comparison lets lookups by const char* skip building a temporary key.
+		pmr::map<pmr::string, PassengerData*, less<>> passenger_name_map_;
+		/// Roster IDs available for reuse. Compaction leaves the lowest ID at the back.
+		pmr::vector<int> free_ids_;
+		/// Drop-offs in time order, starting at retirement_queue_head_; the head entry is always the
+		/// next passenger eligible to retire.
+		pmr::vector<RetirementEntry> retirement_queue_;
+		size_t retirement_queue_head_;
+		/// A request waiting for admission, with the time it was submitted.
+		struct DeferredRequest {
+			PassengerData* data_;
+			Point start_;
+			Point end_;
+			int request_time_;
+		};
+
+		/// Deferred requests in arrival order, starting at deferred_requests_head_. Their passengers are
+		/// flagged as deferred, which keeps them from retiring while they wait.
+		pmr::vector<DeferredRequest> deferred_requests_;
+		size_t deferred_requests_head_;
+		AdmissionPolicy admission_policy_;
+		/// Requests admitted since the start of the current step.
+		int num_admitted_this_tick_;
+		long long num_requests_admitted_;
+		long long num_requests_deferred_;
+		long long num_requests_rejected_;
+
+		/// Cold per-trip data, kept out of the hot Passenger records that scoring scans.
+		struct TripRecord {
+			PassengerData* data_;
+			int request_time_;
+			/// Copy of data_->id_, so bulk queries can index by ID without touching the roster entry.
+			int id_;
+		};
+
+		/// Parallel lists: active_trips_[i] holds the rarely used fields of active_passengers_[i].
+		pmr::vector<Passenger> active_passengers_;
+		pmr::vector<TripRecord> active_trips_;
+		/// Subset of the active passengers that have been picked up, in boarding order.
+		PassengerList passengers_in_car_;
+
+		/// Index of the passenger the car is currently heading toward (lowest predicted systemic
+		/// unhappiness), or -1 if there is none.
+		int next_passenger_index_;
+
+		SnapshotPublisher* snapshot_publisher_;
+		CarStateSeqlock car_state_;
+		RequestQueue* request_queue_;
+		long long num_queued_requests_accepted_;
+		long long num_queued_requests_rejected_;
 
 		bool last_request_made_;
 		bool new_request_made_;
 
+		int current_time_;
+		int idle_retirement_steps_;
+		bool stable_ordering_;
+		int num_roster_entries_;
+		unsigned int next_generation_;
+
+		/// ETA plan. plan_pickup_times_ and plan_dropoff_times_ are indexed by roster ID; the other two
+		/// are scratch space for build_plan(), kept to reuse their buffers.
+		bool plan_valid_;
+		int num_plans_built_;
+		pmr::vector<Passenger> plan_passengers_;
+		pmr::vector<int> plan_ids_;
+		pmr::vector<int> plan_pickup_times_;
+		pmr::vector<int> plan_dropoff_times_;
+		/// Scratch space for estimate_all_next_stops(), parallel to active_passengers_.
+		pmr::vector<uint64_t> bulk_eta_goals_;
+		pmr::vector<int> bulk_eta_dists_;
+
 		int num_trips_completed_;
 		double average_unhappiness_;
 		double average_trip_time_;
@@ -0,0 +1,80 @@
+/**
+ * @file dispatcher_snapshot.cpp
+ * @author Ryan McMahon (mcmahonryan@hotmail.com)
+ */
+#include "dispatcher_snapshot.h"
+#include "dispatcher.h"
+
+namespace ride_share {
+
+	DispatcherSnapshot::DispatcherSnapshot() {
+		time_ = -1;
+		has_car_goal_ = false;
+		num_trips_completed_ = 0;
+		num_in_car_ = 0;
+	}
+
+	void DispatcherSnapshot::clear() {
+		riders_.clear();
+		names_.clear();
+		num_in_car_ = 0;
+	}
+
+	void DispatcherSnapshot::add_rider(const PassengerHandle& handle, string_view name, const Point& start, const Point& end, bool in_car) {
+		Rider rider;
+		rider.handle_ = handle;
+		rider.start_ = start;
+		rider.end_ = end;
+		rider.in_car_ = in_car;
+		rider.name_offset_ = (int)names_.size();
+		rider.name_length_ = (int)name.size();
+		names_.append(name.data(), name.size());
+		riders_.push_back(rider);
+		if (in_car) {
+			num_in_car_++;
+		}
+	}
+
+	SnapshotPublisher::SnapshotPublisher() :
+		published_slot_(0),
+		num_skipped_(0)
+	{
+		for (int i = 0; i < kNumSlots; i++) {
+			slots_[i].num_readers_.store(0);
+		}
+	}
+
+	void SnapshotPublisher::publish(const Dispatcher& dispatcher) {
+		// Readers only ever touch the published slot, or a slot they pinned while it was published, so any
+		// other slot with no readers is ours to overwrite. A reader that raced with this check sees the
+		// published index move on, drops its pin and retries without reading.
+		int published = published_slot_.load();
+		for (int i = 1; i < kNumSlots; i++) {
+			int candidate = (published + i) % kNumSlots;
+			if (slots_[candidate].num_readers_.load() == 0) {
+				dispatcher.write_snapshot(slots_[candidate].snapshot_);
+				published_slot_.store(candidate);
+				return;
+			}
+		}
+		num_skipped_++;
+	}
+
+	ScopedSnapshot::ScopedSnapshot(SnapshotPublisher& publisher) {
+		for (;;) {
+			int index = publisher.published_slot_.load();
+			SnapshotPublisher::Slot* slot = &publisher.slots_[index];
+			slot->num_readers_++;
+			if (publisher.published_slot_.load() == index) {
+				slot_ = slot;
+				return;
+			}
+			slot->num_readers_--;
+		}
+	}
+
+	ScopedSnapshot::~ScopedSnapshot() {
+		slot_->num_readers_--;
+	}
+
+}  // namespace ride_share
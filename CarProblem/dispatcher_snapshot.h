@@ -0,0 +1,125 @@
+/**
+ * @file dispatcher_snapshot.h
+ * @author Ryan McMahon (mcmahonryan@hotmail.com)
+ * @brief Lock-free, copy-on-publish snapshots of dispatcher state for reader threads.
+ */
+#pragma once
+#include <atomic>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "point.h"
+#include "passenger.h"
+
+namespace ride_share {
+
+	class Dispatcher;
+
+	/// @brief Read-only copy of a dispatcher's state as of the end of one step.
+	class DispatcherSnapshot {
+	public:
+		DispatcherSnapshot();
+
+		/// @brief Returns the dispatcher time the snapshot was taken at, or -1 before the first step.
+		int get_time() const { return time_; }
+		Point get_car_pos() const { return car_pos_; }
+
+		/// @brief Returns false when the car has nowhere to go.
+		bool has_car_goal() const { return has_car_goal_; }
+		Point get_car_goal() const { return car_goal_; }
+
+		int get_num_trips_completed() const { return num_trips_completed_; }
+
+		/// @brief Returns the number of active passengers, waiting or riding.
+		int get_num_riders() const { return (int)riders_.size(); }
+		int get_num_in_car() const { return num_in_car_; }
+
+		/// @brief Returns the name of active passenger @p i; valid while the snapshot is held.
+		string_view get_rider_name(int i) const { return string_view(names_.data() + riders_[i].name_offset_, riders_[i].name_length_); }
+		PassengerHandle get_rider_handle(int i) const { return riders_[i].handle_; }
+		Point get_rider_start(int i) const { return riders_[i].start_; }
+		Point get_rider_end(int i) const { return riders_[i].end_; }
+		bool is_rider_in_car(int i) const { return riders_[i].in_car_; }
+
+	private:
+		struct Rider {
+			PassengerHandle handle_;
+			Point start_;
+			Point end_;
+			bool in_car_;
+			int name_offset_;
+			int name_length_;
+		};
+
+		/// @brief Empties the rider lists but keeps their capacity for the next capture.
+		void clear();
+
+		/// @brief Appends one active passenger.
+		void add_rider(const PassengerHandle& handle, string_view name, const Point& start, const Point& end, bool in_car);
+
+		int time_;
+		Point car_pos_;
+		bool has_car_goal_;
+		Point car_goal_;
+		int num_trips_completed_;
+		int num_in_car_;
+		vector<Rider> riders_;
+		/// All rider names back to back, so a capture reuses one buffer instead of one string per rider.
+		string names_;
+
+		friend class Dispatcher;
+	};
+
+	/// @brief Publishes one DispatcherSnapshot per step for any number of reader threads.
+	///
+	/// Snapshots live in a small ring of slots. The simulation thread fills a slot no reader holds and
+	/// then publishes it with a single atomic store; readers pin the latest slot with a reference count.
+	/// Neither side ever takes a lock or waits for the other. If readers happen to pin every spare slot,
+	/// the step's snapshot is skipped instead of stalling the simulation; readers then keep seeing the
+	/// previous one.
+	class SnapshotPublisher {
+	public:
+		static const int kNumSlots = 4;
+
+		SnapshotPublisher();
+		SnapshotPublisher(const SnapshotPublisher&) = delete;
+		SnapshotPublisher& operator=(const SnapshotPublisher&) = delete;
+
+		/// @brief Captures @p dispatcher into a free slot and makes it the latest snapshot.
+		///
+		/// Only the simulation thread may call this; Dispatcher::update() does so once enabled with
+		/// Dispatcher::set_snapshot_publisher().
+		void publish(const Dispatcher& dispatcher);
+
+		/// @brief Returns how many steps were skipped because every spare slot was held by readers.
+		long long get_num_skipped() const { return num_skipped_.load(); }
+
+	private:
+		struct Slot {
+			DispatcherSnapshot snapshot_;
+			atomic<int> num_readers_;
+		};
+
+		Slot slots_[kNumSlots];
+		atomic<int> published_slot_;
+		atomic<long long> num_skipped_;
+
+		friend class ScopedSnapshot;
+	};
+
+	/// @brief Pins the latest published snapshot for as long as the object lives. Safe on any thread.
+	class ScopedSnapshot {
+	public:
+		explicit ScopedSnapshot(SnapshotPublisher& publisher);
+		~ScopedSnapshot();
+		ScopedSnapshot(const ScopedSnapshot&) = delete;
+		ScopedSnapshot& operator=(const ScopedSnapshot&) = delete;
+
+		const DispatcherSnapshot& get() const { return slot_->snapshot_; }
+		const DispatcherSnapshot* operator->() const { return &slot_->snapshot_; }
+
+	private:
+		SnapshotPublisher::Slot* slot_;
+	};
+
+}  // namespace ride_share
@@ -0,0 +1,47 @@
+/**
+ * @file latency_recorder.cpp
+ * @author Ryan McMahon (mcmahonryan@hotmail.com)
+ */
+#include <algorithm>
+#include <cmath>
+#include "latency_recorder.h"
+
+namespace ride_share {
+
+	void LatencyRecorder::merge(const LatencyRecorder& other) {
+		samples_.insert(samples_.end(), other.samples_.begin(), other.samples_.end());
+		sorted_ = false;
+	}
+
+	double LatencyRecorder::get_mean() const {
+		if (samples_.empty()) {
+			return 0.0;
+		}
+		double total = 0.0;
+		for (size_t i = 0; i < samples_.size(); i++) {
+			total += samples_[i];
+		}
+		return total / samples_.size();
+	}
+
+	double LatencyRecorder::get_max() const {
+		if (samples_.empty()) {
+			return 0.0;
+		}
+		return *max_element(samples_.begin(), samples_.end());
+	}
+
+	double LatencyRecorder::get_percentile(double percent) const {
+		if (samples_.empty()) {
+			return 0.0;
+		}
+		if (!sorted_) {
+			sort(samples_.begin(), samples_.end());
+			sorted_ = true;
+		}
+		size_t rank = (size_t)ceil(percent / 100.0 * samples_.size());
+		rank = min(max(rank, (size_t)1), samples_.size());
+		return samples_[rank - 1];
+	}
+
+}  // namespace ride_share
@@ -0,0 +1,41 @@
+/**
+ * @file latency_recorder.h
+ * @author Ryan McMahon (mcmahonryan@hotmail.com)
+ * @brief Collects timing samples and reports percentiles.
+ */
+#pragma once
+#include <vector>
+
+namespace ride_share {
+
+	using namespace std;
+
+	/// @brief Keeps every sample so percentiles are exact. Samples are in whatever unit the caller uses.
+	///
+	/// Not thread-safe; give each thread its own recorder and merge() them afterwards.
+	class LatencyRecorder {
+	public:
+		/// @brief Preallocates room for @p num_samples, so recording in a timed loop never allocates.
+		void reserve(size_t num_samples) { samples_.reserve(num_samples); }
+
+		void record(double sample) { samples_.push_back(sample); sorted_ = false; }
+
+		/// @brief Adds all of @p other's samples to this recorder.
+		void merge(const LatencyRecorder& other);
+
+		void clear() { samples_.clear(); sorted_ = true; }
+
+		size_t get_count() const { return samples_.size(); }
+		double get_mean() const;
+		double get_max() const;
+
+		/// @brief Returns the sample at percentile @p percent (0-100) by nearest rank, or 0 if there are none.
+		double get_percentile(double percent) const;
+
+	private:
+		/// Sorted lazily by the first percentile query after a change.
+		mutable vector<double> samples_;
+		mutable bool sorted_ = true;
+	};
+
+}  // namespace ride_share
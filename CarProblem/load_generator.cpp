@@ -0,0 +1,322 @@
+/**
+ * @file load_generator.cpp
+ * @author Ryan McMahon (mcmahonryan@hotmail.com)
+ */
+#include <chrono>
+#include <deque>
+#include <random>
+#include <thread>
+#include <vector>
+#include "load_generator.h"
+#include "request_server.h"
+#include "request_json.h"
+
+#if RIDE_SHARE_HAS_UNIX_SOCKETS
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace ride_share {
+
+	typedef chrono::steady_clock Clock;
+
+	LoadGenerator::LoadGenerator(const string& socket_path, const CityGrid& grid, int num_connections, int requests_per_connection, int max_in_flight) :
+		socket_path_(socket_path),
+		grid_(grid),
+		num_connections_(num_connections),
+		requests_per_connection_(requests_per_connection),
+		max_in_flight_(max_in_flight)
+	{
+	}
+
+	TickSubscriber::TickSubscriber(const string& socket_path) :
+		socket_path_(socket_path),
+		fd_(-1),
+		num_ticks_(0),
+		num_pickups_(0),
+		num_dropoffs_(0)
+	{
+	}
+
+	TickSubscriber::~TickSubscriber() {
+		stop();
+	}
+
+	RequestClient::RequestClient(const string& socket_path) :
+		socket_path_(socket_path),
+		fd_(-1)
+	{
+	}
+
+	RequestClient::~RequestClient() {
+#if RIDE_SHARE_HAS_UNIX_SOCKETS
+		if (fd_ >= 0) {
+			close(fd_);
+		}
+#endif
+	}
+
+	void LoadGenerator::run() {
+		statistics_ = LoadStatistics();
+		vector<LoadStatistics> connection_statistics(num_connections_);
+		vector<string> errors(num_connections_);
+		vector<thread> threads;
+
+		Clock::time_point start_time = Clock::now();
+		for (int i = 0; i < num_connections_; i++) {
+			threads.push_back(thread(&LoadGenerator::run_connection, this, i, &connection_statistics[i], &errors[i]));
+		}
+		for (size_t i = 0; i < threads.size(); i++) {
+			threads[i].join();
+		}
+		statistics_.seconds_ = chrono::duration<double>(Clock::now() - start_time).count();
+
+		for (int i = 0; i < num_connections_; i++) {
+			if (!errors[i].empty()) {
+				ServerException ex(errors[i]);
+				throw ex;
+			}
+			statistics_.num_sent_ += connection_statistics[i].num_sent_;
+			statistics_.num_acked_ += connection_statistics[i].num_acked_;
+			statistics_.num_errors_ += connection_statistics[i].num_errors_;
+			statistics_.latency_.merge(connection_statistics[i].latency_);
+		}
+	}
+
+#if RIDE_SHARE_HAS_UNIX_SOCKETS
+
+	void LoadGenerator::run_connection(int connection_index, LoadStatistics* ret_statistics, string* ret_error) {
+		sockaddr_un address;
+		memset(&address, 0, sizeof(address));
+		address.sun_family = AF_UNIX;
+		strncpy(address.sun_path, socket_path_.c_str(), sizeof(address.sun_path) - 1);
+
+		int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (fd < 0 || connect(fd, (sockaddr*)&address, sizeof(address)) != 0) {
+			*ret_error = string("connect failed: ") + strerror(errno);
+			if (fd >= 0) {
+				close(fd);
+			}
+			return;
+		}
+#ifdef SO_NOSIGPIPE
+		int on = 1;
+		setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+#ifdef MSG_NOSIGNAL
+		const int flags = MSG_NOSIGNAL;
+#else
+		const int flags = 0;
+#endif
+
+		minstd_rand rng(connection_index + 1);
+		int width = grid_.get_width();
+		int height = grid_.get_height();
+		deque<Clock::time_point> send_times;
+		ret_statistics->latency_.reserve(requests_per_connection_);
+		string read_buffer;
+		char buffer[4096];
+		int num_sent = 0;
+		int num_answered = 0;
+
+		while (num_answered < requests_per_connection_) {
+			while (num_sent < requests_per_connection_ && num_sent - num_answered < max_in_flight_) {
+				int start_x = rng() % width;
+				int start_y = rng() % height;
+				int end_x = (start_x + 1 + rng() % max(width - 1, 1)) % width;
+				int end_y = rng() % height;
+				string line = "{\"name\":\"Load" + to_string(connection_index) + "_" + to_string(num_sent)
+					+ "\",\"start\":[" + to_string(start_x) + "," + to_string(start_y)
+					+ "],\"end\":[" + to_string(end_x) + "," + to_string(end_y) + "]}\n";
+				send_times.push_back(Clock::now());
+				size_t sent_total = 0;
+				while (sent_total < line.size()) {
+					ssize_t sent = send(fd, line.data() + sent_total, line.size() - sent_total, flags);
+					if (sent < 0) {
+						*ret_error = string("send failed: ") + strerror(errno);
+						close(fd);
+						return;
+					}
+					sent_total += (size_t)sent;
+				}
+				num_sent++;
+			}
+
+			ssize_t num_read = recv(fd, buffer, sizeof(buffer), 0);
+			if (num_read <= 0) {
+				*ret_error = "Server closed the connection";
+				close(fd);
+				return;
+			}
+			Clock::time_point now = Clock::now();
+			read_buffer.append(buffer, (size_t)num_read);
+			size_t line_start = 0;
+			size_t line_end;
+			while ((line_end = read_buffer.find('\n', line_start)) != string::npos) {
+				// Replies are dumped with sorted keys, so an ack always starts with {"ack":. Anything else
+				// sent to a connection that hasn't subscribed is an error reply.
+				if (read_buffer.compare(line_start, 7, "{\"ack\":") == 0) {
+					ret_statistics->num_acked_++;
+				}
+				else {
+					ret_statistics->num_errors_++;
+				}
+				ret_statistics->latency_.record(chrono::duration<double, micro>(now - send_times.front()).count());
+				send_times.pop_front();
+				num_answered++;
+				line_start = line_end + 1;
+			}
+			read_buffer.erase(0, line_start);
+		}
+		ret_statistics->num_sent_ = num_sent;
+		close(fd);
+	}
+
+	void TickSubscriber::start() {
+		sockaddr_un address;
+		memset(&address, 0, sizeof(address));
+		address.sun_family = AF_UNIX;
+		strncpy(address.sun_path, socket_path_.c_str(), sizeof(address.sun_path) - 1);
+
+		fd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+		const char subscribe[] = "{\"subscribe\":true}\n";
+		if (fd_ < 0 || connect(fd_, (sockaddr*)&address, sizeof(address)) != 0
+			|| send(fd_, subscribe, sizeof(subscribe) - 1, 0) != (ssize_t)(sizeof(subscribe) - 1)) {
+			string info = string("Subscribing failed: ") + strerror(errno);
+			stop();
+			ServerException ex(info);
+			throw ex;
+		}
+		reader_ = thread(&TickSubscriber::read_events, this);
+	}
+
+	void TickSubscriber::stop() {
+		if (fd_ >= 0) {
+			// Wakes the reader out of recv(); the descriptor is only closed once it has finished.
+			shutdown(fd_, SHUT_RDWR);
+		}
+		if (reader_.joinable()) {
+			reader_.join();
+		}
+		if (fd_ >= 0) {
+			close(fd_);
+			fd_ = -1;
+		}
+	}
+
+	void TickSubscriber::read_events() {
+		string read_buffer;
+		char buffer[4096];
+		for (;;) {
+			ssize_t num_read = recv(fd_, buffer, sizeof(buffer), 0);
+			if (num_read <= 0) {
+				return;
+			}
+			read_buffer.append(buffer, (size_t)num_read);
+			size_t line_start = 0;
+			size_t line_end;
+			while ((line_end = read_buffer.find('\n', line_start)) != string::npos) {
+				json event = json::parse(read_buffer.begin() + line_start, read_buffer.begin() + line_end, nullptr, false);
+				if (event.is_object() && event.contains("tick")) {
+					num_ticks_++;
+					num_pickups_ += (long long)event["pickups"].size();
+					num_dropoffs_ += (long long)event["dropoffs"].size();
+				}
+				line_start = line_end + 1;
+			}
+			read_buffer.erase(0, line_start);
+		}
+	}
+
+	void RequestClient::connect() {
+		sockaddr_un address;
+		memset(&address, 0, sizeof(address));
+		address.sun_family = AF_UNIX;
+		strncpy(address.sun_path, socket_path_.c_str(), sizeof(address.sun_path) - 1);
+
+		fd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (fd_ < 0 || ::connect(fd_, (sockaddr*)&address, sizeof(address)) != 0) {
+			string info = string("connect failed: ") + strerror(errno);
+			ServerException ex(info);
+			throw ex;
+		}
+#ifdef SO_NOSIGPIPE
+		int on = 1;
+		setsockopt(fd_, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+	}
+
+	bool RequestClient::send_text(const string& text) {
+#ifdef MSG_NOSIGNAL
+		const int flags = MSG_NOSIGNAL;
+#else
+		const int flags = 0;
+#endif
+		size_t sent_total = 0;
+		while (sent_total < text.size()) {
+			ssize_t sent = send(fd_, text.data() + sent_total, text.size() - sent_total, flags);
+			if (sent < 0) {
+				return false;
+			}
+			sent_total += (size_t)sent;
+		}
+		return true;
+	}
+
+	bool RequestClient::read_line(string* ret_line, chrono::milliseconds timeout) {
+		Clock::time_point give_up = Clock::now() + timeout;
+		size_t line_end;
+		while ((line_end = read_buffer_.find('\n')) == string::npos) {
+			int timeout_ms = (int)chrono::ceil<chrono::milliseconds>(give_up - Clock::now()).count();
+			pollfd poll_fd = { fd_, POLLIN, 0 };
+			if (timeout_ms <= 0 || poll(&poll_fd, 1, timeout_ms) <= 0) {
+				return false;
+			}
+			char buffer[4096];
+			ssize_t num_read = recv(fd_, buffer, sizeof(buffer), 0);
+			if (num_read <= 0) {
+				return false;
+			}
+			read_buffer_.append(buffer, (size_t)num_read);
+		}
+		*ret_line = read_buffer_.substr(0, line_end);
+		read_buffer_.erase(0, line_end + 1);
+		return true;
+	}
+
+#else
+
+	void LoadGenerator::run_connection(int connection_index, LoadStatistics* ret_statistics, string* ret_error) {
+		*ret_error = "Unix domain sockets are not supported on this platform";
+	}
+
+	void TickSubscriber::start() {
+		string info = "Unix domain sockets are not supported on this platform";
+		ServerException ex(info);
+		throw ex;
+	}
+
+	void TickSubscriber::stop() {
+	}
+
+	void RequestClient::connect() {
+		string info = "Unix domain sockets are not supported on this platform";
+		ServerException ex(info);
+		throw ex;
+	}
+
+	bool RequestClient::send_text(const string& text) {
+		return false;
+	}
+
+	bool RequestClient::read_line(string* ret_line, chrono::milliseconds timeout) {
+		return false;
+	}
+
+#endif
+
+}  // namespace ride_share
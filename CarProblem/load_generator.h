@@ -0,0 +1,123 @@
+/**
+ * @file load_generator.h
+ * @author Ryan McMahon (mcmahonryan@hotmail.com)
+ * @brief Local multi-connection load generator for RequestServer.
+ */
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include "city_grid.h"
+#include "latency_recorder.h"
+
+namespace ride_share {
+
+	using namespace std;
+
+	/// @brief Results of LoadGenerator::run(). Latencies are in microseconds, from send to reply.
+	class LoadStatistics {
+	public:
+		long long get_num_sent() const { return num_sent_; }
+		long long get_num_acked() const { return num_acked_; }
+		long long get_num_errors() const { return num_errors_; }
+		double get_seconds() const { return seconds_; }
+		double get_requests_per_second() const { return seconds_ > 0.0 ? num_acked_ / seconds_ : 0.0; }
+		const LatencyRecorder& get_latency() const { return latency_; }
+
+	private:
+		friend class LoadGenerator;
+		long long num_sent_ = 0;
+		long long num_acked_ = 0;
+		long long num_errors_ = 0;
+		double seconds_ = 0.0;
+		LatencyRecorder latency_;
+	};
+
+	/// @brief Opens several connections to a RequestServer and sends random valid requests over each.
+	///
+	/// Each connection runs on its own thread and keeps up to a fixed number of requests in flight.
+	/// The server answers a connection's requests in the order they were sent, so every reply is
+	/// matched to the oldest outstanding send time. Passenger names are unique per request.
+	class LoadGenerator {
+	public:
+		/// @param socket_path Path the server is listening on.
+		/// @param grid City the server is running, used to pick valid coordinates.
+		/// @param num_connections Number of connections (and threads).
+		/// @param requests_per_connection Requests sent over each connection.
+		/// @param max_in_flight Requests a connection may have sent but not yet had answered.
+		LoadGenerator(const string& socket_path, const CityGrid& grid, int num_connections, int requests_per_connection, int max_in_flight);
+
+		/// @brief Runs every connection to completion. Throws ServerException if a connection fails.
+		void run();
+
+		const LoadStatistics& get_statistics() const { return statistics_; }
+
+	private:
+		/// @brief Sends and times every request for one connection, recording into @p ret_statistics.
+		void run_connection(int connection_index, LoadStatistics* ret_statistics, string* ret_error);
+
+		string socket_path_;
+		CityGrid grid_;
+		int num_connections_;
+		int requests_per_connection_;
+		int max_in_flight_;
+		LoadStatistics statistics_;
+	};
+
+	/// @brief Subscribes to a RequestServer's tick stream on a background thread and counts the events.
+	class TickSubscriber {
+	public:
+		explicit TickSubscriber(const string& socket_path);
+		~TickSubscriber();
+		TickSubscriber(const TickSubscriber&) = delete;
+		TickSubscriber& operator=(const TickSubscriber&) = delete;
+
+		/// @brief Connects, subscribes and starts reading. Throws ServerException if the connection fails.
+		void start();
+
+		/// @brief Disconnects and waits for the reader thread to finish.
+		void stop();
+
+		int get_num_ticks() const { return num_ticks_.load(); }
+		long long get_num_pickups() const { return num_pickups_.load(); }
+		long long get_num_dropoffs() const { return num_dropoffs_.load(); }
+
+	private:
+		void read_events();
+
+		string socket_path_;
+		int fd_;
+		thread reader_;
+		atomic<int> num_ticks_;
+		atomic<long long> num_pickups_;
+		atomic<long long> num_dropoffs_;
+	};
+
+	/// @brief A single blocking connection to a RequestServer, for sending hand-written lines and
+	///        reading the replies one at a time.
+	class RequestClient {
+	public:
+		explicit RequestClient(const string& socket_path);
+		~RequestClient();
+		RequestClient(const RequestClient&) = delete;
+		RequestClient& operator=(const RequestClient&) = delete;
+
+		/// @brief Connects to the server. Throws ServerException if the connection fails.
+		void connect();
+
+		/// @brief Sends @p text exactly as given, so it should end with a newline.
+		/// @return False if the server has closed the connection.
+		bool send_text(const string& text);
+
+		/// @brief Waits up to @p timeout for the next line from the server.
+		/// @return False if the server closed the connection or no line arrived in time.
+		bool read_line(string* ret_line, chrono::milliseconds timeout);
+
+	private:
+		string socket_path_;
+		int fd_;
+		string read_buffer_;
+	};
+
+}  // namespace ride_share
@@ -0,0 +1,94 @@
+/**
+ * @file mapped_file.cpp
+ * @author Ryan McMahon (mcmahonryan@hotmail.com)
+ */
+#include <cstring>
+#include <fstream>
+#include "mapped_file.h"
+
+#if RIDE_SHARE_HAS_MMAP
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ride_share {
+
+#if RIDE_SHARE_HAS_MMAP
+
+	/// @brief Throws a MappedFileException describing the failed call and errno.
+	static void throw_file_error(const char* what, const string& path) {
+		string info = string(what) + " failed for " + path + ": " + strerror(errno);
+		MappedFileException ex(info);
+		throw ex;
+	}
+
+	MappedFile::MappedFile(const string& path) :
+		data_(""),
+		size_(0),
+		mapping_(nullptr)
+	{
+		int fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0) {
+			throw_file_error("open", path);
+		}
+		struct stat file_stat;
+		if (fstat(fd, &file_stat) != 0) {
+			close(fd);
+			throw_file_error("fstat", path);
+		}
+		// An empty file can't be mapped, and doesn't need to be.
+		size_ = (size_t)file_stat.st_size;
+		if (size_ > 0) {
+			void* mapping = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (mapping == MAP_FAILED) {
+				close(fd);
+				throw_file_error("mmap", path);
+			}
+			mapping_ = mapping;
+			data_ = (const char*)mapping;
+			// Only a hint, so a failure is not an error.
+			madvise(mapping_, size_, MADV_SEQUENTIAL);
+		}
+		// The mapping keeps the file open.
+		close(fd);
+	}
+
+	MappedFile::~MappedFile() {
+		if (mapping_) {
+			munmap(mapping_, size_);
+		}
+	}
+
+#else
+
+	MappedFile::MappedFile(const string& path) :
+		data_(""),
+		size_(0),
+		mapping_(nullptr)
+	{
+		ifstream file(path, ios::binary | ios::ate);
+		if (!file) {
+			string info = "open failed for " + path;
+			MappedFileException ex(info);
+			throw ex;
+		}
+		buffer_.resize((size_t)file.tellg());
+		file.seekg(0);
+		if (!buffer_.empty() && !file.read(buffer_.data(), buffer_.size())) {
+			string info = "read failed for " + path;
+			MappedFileException ex(info);
+			throw ex;
+		}
+		data_ = buffer_.empty() ? "" : buffer_.data();
+		size_ = buffer_.size();
+	}
+
+	MappedFile::~MappedFile() {
+	}
+
+#endif
+
+}  // namespace ride_share
@@ -0,0 +1,67 @@
+/**
+ * @file mapped_file.h
+ * @author Ryan McMahon (mcmahonryan@hotmail.com)
+ * @brief Read-only memory mapping of a whole file.
+ */
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define RIDE_SHARE_HAS_MMAP 1
+#else
+#define RIDE_SHARE_HAS_MMAP 0
+#endif
+
+namespace ride_share {
+
+	using namespace std;
+
+	/// @brief Exception thrown when a file cannot be opened or mapped.
+	class MappedFileException {
+	public:
+		MappedFileException() {
+			info_ = "";
+		}
+		MappedFileException(const char* info) {
+			info_ = info;
+		}
+		MappedFileException(const string& info) {
+			info_ = info;
+		}
+		string get_info() { return info_; }
+	private:
+		string info_;
+	};
+
+	/// @brief A file's contents, mapped read-only for the lifetime of the object.
+	///
+	/// Parsers read the bytes straight out of the page cache instead of having them copied through
+	/// stream buffers first, and the mapping is advised for sequential access so the kernel reads ahead
+	/// and drops pages behind the reader. Where mmap is unavailable the file is read into memory once
+	/// instead, behind the same interface.
+	class MappedFile {
+	public:
+		/// @brief Maps the file at @p path. Throws MappedFileException if it can't be opened or mapped.
+		explicit MappedFile(const string& path);
+		~MappedFile();
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		/// @brief Returns the first byte of the file. Not null-terminated.
+		const char* get_data() const { return data_; }
+		size_t get_size() const { return size_; }
+
+		/// @brief Returns true if the contents are mapped rather than read into a buffer.
+		bool is_mapped() const { return mapping_ != nullptr; }
+
+	private:
+		const char* data_;
+		size_t size_;
+		void* mapping_;
+		/// Holds the contents when they are read rather than mapped.
+		vector<char> buffer_;
+	};
+
+}  // namespace ride_share
@@ -23,94 +23,93 @@ namespace ride_share {
 		info_ = "Passenger with name " + string(name) + " not found";
 	}
 
-	PassengerData::PassengerData(const char* name, int id) {
-		name_ = name;
+	PassengerData::PassengerData(const char* name, int id, unsigned int generation, pmr::memory_resource* resource) :
+		name_(name, resource)
+	{
 		id_ = id;
+		generation_ = generation;
+		last_active_time_ = 0;
+		active_index_ = -1;
+		deferred_ = false;
 	}
 
-	Passenger::Passenger(PassengerData* data) :
-		ideal_pickup_time_(-1),
-		ideal_journey_time_(-1),
-		time_elapsed_(0),
-		time_since_pickup_(-1),
-		dropped_off_(false)
+	Passenger::Passenger() :
+		start_x_(0),
+		start_y_(0),
+		end_x_(0),
+		end_y_(0),
+		ideal_pickup_time_(0),
+		ideal_journey_time_(0),
+		phase_start_time_(0)
 	{
-		data_ = data;
 	}
 
-	void Passenger::activate(const Point& start, const Point& end) {
-		Point grid_dims = Point::get_grid_dims();
+	void Passenger::activate(const Point& start, const Point& end, int now, const CityGrid& grid) {
 		PassengerException ex;
-		if (start.x() < 0 || start.y() < 0 || start.x() >= grid_dims.x() || start.y() >= grid_dims.y()) {
+		if (!grid.contains(start)) {
 			ex.out_of_range(start.x(), start.y(), "start");
 			throw ex;
 		}
-		if (end.x() < 0 || end.y() < 0 || end.x() >= grid_dims.x() || end.y() >= grid_dims.y()) {
+		if (!grid.contains(end)) {
 			ex.out_of_range(end.x(), end.y(), "end");
 			throw ex;
 		}
-		start_ = start;
-		end_ = end;
-		ideal_pickup_time_ = -1;
-		ideal_journey_time_ = -1;
-		time_elapsed_ = 0;
-		time_since_pickup_ = -1;
-		dropped_off_ = false;
+		start_x_ = (uint16_t)start.x();
+		start_y_ = (uint16_t)start.y();
+		end_x_ = (uint16_t)end.x();
+		end_y_ = (uint16_t)end.y();
+		ideal_pickup_time_ = 0;
+		ideal_journey_time_ = 0;
+		phase_start_time_ = (uint32_t)now;
 	}
 
 	void Passenger::compute_ideal_times(const Point& car_pt) {
-		ideal_pickup_time_ = Point::get_dist(car_pt, start_);
-		ideal_journey_time_ = Point::get_dist(start_, end_);
+		int ideal_pickup_time = Point::get_dist(car_pt, get_start());
+		int ideal_journey_time = Point::get_dist(get_start(), get_end());
+		ideal_pickup_time_ = (uint16_t)((ideal_pickup_time < kMaxIdealTime) ? ideal_pickup_time : kMaxIdealTime);
+		ideal_journey_time_ = (uint16_t)((ideal_journey_time < kMaxIdealTime) ? ideal_journey_time : kMaxIdealTime);
 	}
 
-	int Passenger::compute_perfect_time(const Point& car_pt) {
+	int Passenger::compute_perfect_time(const Point& car_pt) const {
 		int perfect_time = 0;
 		if (is_picked_up()) {
-			perfect_time = Point::get_dist(car_pt, end_);
+			perfect_time = Point::get_dist(car_pt, get_end());
 		}
 		else {
-			perfect_time = Point::get_dist(car_pt, start_) + Point::get_dist(start_, end_);
+			perfect_time = Point::get_dist(car_pt, get_start()) + Point::get_dist(get_start(), get_end());
 		}
 		return perfect_time;
 	}
 
-	bool Passenger::update(const Point& car_pt) {
-		bool change_occurred = false;
+	PassengerEvent Passenger::update(const Point& car_pt, int now) {
 		if (is_picked_up()) {
-			if (car_pt == end_) {
-				dropped_off_ = true;
-				change_occurred = true;
-			}
-		}
-		else
-		{
-			if (car_pt == start_) {
-				time_since_pickup_ = 0;
-				change_occurred = true;
+			if (car_pt.x() == end_x_ && car_pt.y() == end_y_) {
+				return PassengerEvent::DroppedOff;
 			}
 		}
-		time_elapsed_++;
-		if (is_picked_up()) {
-			time_since_pickup_++;
+		else if (car_pt.x() == start_x_ && car_pt.y() == start_y_) {
+			// Boarding counts as the first step of the journey.
+			ideal_pickup_time_ = kPickedUp;
+			phase_start_time_ = (uint32_t)(now - 1);
+			return PassengerEvent::PickedUp;
 		}
-		return change_occurred;
+		return PassengerEvent::None;
 	}
 
-	float Passenger::get_unhappiness_score() {
-		int time_elapsed = is_picked_up() ? time_since_pickup_ : time_elapsed_;
-		return do_unhappiness_calc(time_elapsed);
+	float Passenger::get_unhappiness_score(int now) const {
+		return do_unhappiness_calc(now - (int)phase_start_time_);
 	}
 
-	float Passenger::predict_unhappiness_score(const Point& car_pt, int time_delta) {
-		int time_elapsed = is_picked_up() ? time_since_pickup_ : time_elapsed_;
+	float Passenger::predict_unhappiness_score(const Point& car_pt, int now, int time_delta) const {
+		int time_elapsed = now - (int)phase_start_time_;
 		return do_unhappiness_calc(time_elapsed + time_delta + compute_perfect_time(car_pt));
 	}
 
-	const Point& Passenger::get_car_goal() const {
-		return is_picked_up() ? end_ : start_;
+	Point Passenger::get_car_goal() const {
+		return is_picked_up() ? get_end() : get_start();
 	}
 
-	float Passenger::do_unhappiness_calc(int time_elapsed) {
+	float Passenger::do_unhappiness_calc(int time_elapsed) const {
 		// Passengers don't become unhappy until 50% over ideal time (bias = 1.5).
 		// Below that threshold, unhappiness is negative (i.e. the passenger is happy).
 		float bias = 1.5;
@@ -4,8 +4,11 @@
  * @brief Passenger classes and exception type for the ride-share simulation.
  */
 #pragma once
+#include <cstdint>
 #include <string>
+#include <memory_resource>
 #include "point.h"
+#include "city_grid.h"
 
 namespace ride_share {
 
@@ -34,31 +37,79 @@ namespace ride_share {
 		string info_;
 	};
 
+	/// @brief Stable reference to a known passenger.
+	///
+	/// Roster IDs are recycled once a passenger retires, so the handle also carries the
+	/// generation the ID was issued under. A handle to a retired passenger never matches again.
+	class PassengerHandle {
+	public:
+		PassengerHandle() : id_(-1), generation_(0) {}
+		PassengerHandle(int id, unsigned int generation) : id_(id), generation_(generation) {}
+
+		int id() const { return id_; }
+		unsigned int generation() const { return generation_; }
+
+		/// @brief Returns false for a default-constructed handle.
+		bool is_valid() const { return id_ >= 0; }
+
+		bool operator==(const PassengerHandle& other) const { return id_ == other.id_ && generation_ == other.generation_; }
+
+	private:
+		int id_;
+		unsigned int generation_;
+	};
+
 	/// @brief Lightweight record identifying a known passenger by name and ID.
 	class PassengerData {
 	public:
-		PassengerData(const char* name, int id);
-		const string& get_name() { return name_; }
+		PassengerData(const char* name, int id, unsigned int generation, pmr::memory_resource* resource);
+		const pmr::string& get_name() { return name_; }
+		PassengerHandle get_handle() const { return PassengerHandle(id_, generation_); }
 
 	private:
 		int id_;
-		string name_;
+		unsigned int generation_;
+		pmr::string name_;
+		/// Time step of the most recent drop-off; used to decide when an idle passenger retires.
+		int last_active_time_;
+		/// Index into the dispatcher's active passenger list, or -1 without an active ride.
+		int active_index_;
+		/// True while a request from this passenger waits in the dispatcher's deferred queue.
+		bool deferred_;
 
 		friend class Dispatcher;
 	};
 
+	/// @brief What happened to a passenger during one time step.
+	enum class PassengerEvent {
+		None,
+		PickedUp,
+		DroppedOff
+	};
+
 	/// @brief Represents a passenger in transit — waiting for pickup or riding in the car.
+	///
+	/// This is the hot record the dispatcher scans when scoring, packed into 16 bytes so that four
+	/// fit in a cache line. Coordinates are stored in 16 bits, which is why CityGrid caps each side
+	/// at 65536. Instead of counters that tick every step, the record keeps the time its current
+	/// phase began (the request while waiting, the pickup once aboard) and derives elapsed time from
+	/// the dispatcher's clock. Anything not needed for scoring lives in the dispatcher's TripRecord.
 	class Passenger {
 	public:
-		Passenger(PassengerData* data);
+		/// @brief Largest value either ideal time can hold. Longer ideal times are clamped.
+		static const int kMaxIdealTime = 0xFFFE;
+
+		Passenger();
 
 		/// @brief Activates a new ride request for this passenger.
 		/// @param start Pickup location.
 		/// @param end Drop-off location.
-		void activate(const Point& start, const Point& end);
+		/// @param now Current dispatcher time.
+		/// @param grid City the ride takes place in; both locations must lie inside it.
+		void activate(const Point& start, const Point& end, int now, const CityGrid& grid);
 
 		/// @brief Returns true if the passenger has been picked up.
-		bool is_picked_up() const { return time_since_pickup_ != -1; }
+		bool is_picked_up() const { return ideal_pickup_time_ == kPickedUp; }
 
 		/// @brief Computes best-case pickup and journey times from the car's current position.
 		/// @param car_pt Current car position.
@@ -66,15 +117,17 @@ namespace ride_share {
 
 		/// @brief Returns the minimum time to fully serve this passenger starting from car_pt right now.
 		/// @param car_pt Current car position.
-		int compute_perfect_time(const Point& car_pt);
+		int compute_perfect_time(const Point& car_pt) const;
 
-		/// @brief Advances the passenger state by one time step.
+		/// @brief Advances the passenger state to time @p now.
 		/// @param car_pt Current car position.
-		/// @return True if a state change (pickup or drop-off) occurred.
-		bool update(const Point& car_pt);
+		/// @param now Dispatcher time after this step.
+		/// @return The pickup or drop-off that occurred, if any.
+		PassengerEvent update(const Point& car_pt, int now);
 
 		/// @brief Returns the passenger's current unhappiness score.
-		float get_unhappiness_score();
+		/// @param now Current dispatcher time.
+		float get_unhappiness_score(int now) const;
 
 		/// @brief Predicts unhappiness assuming the car heads to this passenger next.
 		///
@@ -82,27 +135,34 @@ namespace ride_share {
 		/// @p time_delta steps pass before the car begins serving this passenger.
 		///
 		/// @param car_pt Position the car will be at when it starts serving this passenger.
+		/// @param now Current dispatcher time.
 		/// @param time_delta Steps until the car begins heading toward this passenger.
 		/// @return Predicted unhappiness at time of drop-off.
-		float predict_unhappiness_score(const Point& car_pt, int time_delta = 0);
+		float predict_unhappiness_score(const Point& car_pt, int now, int time_delta = 0) const;
 
 		/// @brief Returns the position the car must reach next for this passenger (pickup or drop-off).
-		const Point& get_car_goal() const;
+		Point get_car_goal() const;
 
-	private:
-		/// @brief Core unhappiness formula given an elapsed time value.
-		float do_unhappiness_calc(int time_elapsed);
+		Point get_start() const { return Point(start_x_, start_y_); }
+		Point get_end() const { return Point(end_x_, end_y_); }
 
-		PassengerData* data_;
-		Point start_;
-		Point end_;
-		int ideal_pickup_time_;
-		int ideal_journey_time_;
-		int time_elapsed_;
-		int time_since_pickup_;
-		bool dropped_off_;
+	private:
+		/// Stored in ideal_pickup_time_ once the passenger boards; the pickup time is no longer needed.
+		static const uint16_t kPickedUp = 0xFFFF;
 
-		friend class Dispatcher;
+		/// @brief Core unhappiness formula given an elapsed time value.
+		float do_unhappiness_calc(int time_elapsed) const;
+
+		uint16_t start_x_;
+		uint16_t start_y_;
+		uint16_t end_x_;
+		uint16_t end_y_;
+		uint16_t ideal_pickup_time_;
+		uint16_t ideal_journey_time_;
+		/// Time the current phase began: the request while waiting, the pickup once aboard.
+		uint32_t phase_start_time_;
 	};
 
+	static_assert(sizeof(Passenger) == 16, "Passenger is expected to pack into 16 bytes");
+
 }  // namespace ride_share
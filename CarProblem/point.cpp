@@ -10,59 +10,29 @@ namespace ride_share {
 
 	using namespace std;
 
-	Point Point::grid_dims_;
-
-	Point::Point() {
-		x_ = 0;
-		y_ = 0;
-	}
-
-	Point::Point(int x, int y) {
-		x_ = x;
-		y_ = y;
-	}
-
-	Point::Point(const Point& other)
-	{
-		x_ = other.x_;
-		y_ = other.y_;
-	}
+	static_assert(Point::get_dist(Point(1, 2), Point(4, 0)) == 5, "get_dist must be usable at compile time");
+	static_assert(Point::unpack(Point(-3, 7).pack()) == Point(-3, 7), "pack() must round-trip negative coordinates");
 
 	string Point::get_string() const {
 		string result = "(" + std::to_string(x_) + "," + std::to_string(y_) + ")";
 		return result;
 	}
 
-	bool Point::operator==(const Point& other) const {
-		return (x_ == other.x_ && y_ == other.y_);
-	}
-
-	void Point::operator=(const Point& other) {
-		x_ = other.x_;
-		y_ = other.y_;
-	}
-
-	Point Point::operator+(const Point& other) const {
-		Point point(this->x_ + other.x_, this->y_ + other.y_);
-		return point;
-	}
-
-	Point Point::operator-(const Point& other) const {
-		Point point(this->x_ - other.x_, this->y_ - other.y_);
-		return point;
-	}
-
-	void Point::set_grid_dims(int x, int y) {
-		grid_dims_.set(x, y);
-	}
-
-	Point Point::get_grid_dims() {
-		return grid_dims_;
+	void Point::get_dist(const Point* points, int count, const Point& origin, int* ret_dists) {
+		for (int i = 0; i < count; i++) {
+			ret_dists[i] = get_dist(origin, points[i]);
+		}
 	}
 
-	int Point::get_dist(const Point& pt1, const Point& pt2) {
-		Point delta = pt2 - pt1;
-		return abs(delta.x()) + abs(delta.y());
+	void Point::get_dist_packed(const uint64_t* packed_points, int count, uint64_t packed_origin, int* ret_dists) {
+		// Branch-free over plain integer lanes so the compiler can vectorize it.
+		int32_t origin_x = (int32_t)(uint32_t)packed_origin;
+		int32_t origin_y = (int32_t)(uint32_t)(packed_origin >> 32);
+		for (int i = 0; i < count; i++) {
+			int32_t dx = (int32_t)(uint32_t)packed_points[i] - origin_x;
+			int32_t dy = (int32_t)(uint32_t)(packed_points[i] >> 32) - origin_y;
+			ret_dists[i] = abs(dx) + abs(dy);
+		}
 	}
 
 }  // namespace ride_share
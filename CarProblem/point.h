@@ -4,43 +4,59 @@
  * @brief 2D grid coordinate for the city simulation.
  */
 #pragma once
+#include <cstdint>
 #include <string>
+#include <type_traits>
 
 namespace ride_share {
 
 	using namespace std;
 
 	/// @brief Represents a single point within the city grid, or a delta between two points.
+	///
+	/// A trivially copyable value type: arrays of points can be memcpy'd and bulk-moved, and loops
+	/// over them are candidates for auto-vectorization.
 	class Point {
 	public:
-		Point();
-		Point(int x, int y);
-		Point(const Point& other);
+		constexpr Point() : x_(0), y_(0) {}
+		constexpr Point(int x, int y) : x_(x), y_(y) {}
 
-		void set(int x, int y) { x_ = x; y_ = y; }
-		int x() const { return x_; }
-		int y() const { return y_; }
+		constexpr void set(int x, int y) { x_ = x; y_ = y; }
+		constexpr int x() const { return x_; }
+		constexpr int y() const { return y_; }
 
 		/// @brief Returns a human-readable "(x,y)" string.
 		string get_string() const;
 
-		bool operator==(const Point& other) const;
-		void operator=(const Point& other);
-		Point operator+(const Point& other) const;
-		Point operator-(const Point& other) const;
+		constexpr bool operator==(const Point& other) const { return (x_ == other.x_ && y_ == other.y_); }
+		constexpr Point operator+(const Point& other) const { return Point(x_ + other.x_, y_ + other.y_); }
+		constexpr Point operator-(const Point& other) const { return Point(x_ - other.x_, y_ - other.y_); }
 
-		/// @brief Sets the global city grid dimensions.
-		static void set_grid_dims(int x, int y);
+		/// @brief Returns the point packed into 64 bits: x in the low 32 bits, y in the high 32 bits.
+		///
+		/// An array of packed points is an array of (x, y) int32 pairs, which SIMD kernels can load directly.
+		constexpr uint64_t pack() const { return (uint64_t)(uint32_t)x_ | ((uint64_t)(uint32_t)y_ << 32); }
 
-		/// @brief Returns the global city grid dimensions.
-		static Point get_grid_dims();
+		/// @brief Inverse of pack().
+		static constexpr Point unpack(uint64_t packed) { return Point((int32_t)(uint32_t)packed, (int32_t)(uint32_t)(packed >> 32)); }
 
 		/// @brief Returns the Manhattan distance between two arbitrary points.
-		static int get_dist(const Point& pt1, const Point& pt2);
+		static constexpr int get_dist(const Point& pt1, const Point& pt2) {
+			int dx = pt2.x_ - pt1.x_;
+			int dy = pt2.y_ - pt1.y_;
+			return (dx < 0 ? -dx : dx) + (dy < 0 ? -dy : dy);
+		}
+
+		/// @brief Writes the Manhattan distance from @p origin to each of @p count points into @p ret_dists.
+		static void get_dist(const Point* points, int count, const Point& origin, int* ret_dists);
+
+		/// @brief Same as get_dist() over points encoded with pack().
+		static void get_dist_packed(const uint64_t* packed_points, int count, uint64_t packed_origin, int* ret_dists);
 
 	private:
 		int x_, y_;
-		static Point grid_dims_;
 	};
 
+	static_assert(is_trivially_copyable<Point>::value, "Point must stay trivially copyable");
+
 }  // namespace ride_share
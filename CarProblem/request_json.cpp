@@ -0,0 +1,101 @@
+/**
+ * @file request_json.cpp
+ * @author Ryan McMahon (mcmahonryan@hotmail.com)
+ */
+#include <climits>
+#include "request_json.h"
+
+namespace ride_share {
+
+	void process_request_json(json& json_obj, string* ret_name, int* start_x, int* start_y, int* end_x, int* end_y)
+	{
+		if (!json_obj.contains("name")) {
+			string info = "Name missing from requests JSON object";
+			JSONException ex(info);
+			throw ex;
+		}
+		if (!json_obj.contains("start")) {
+			string info = "Start missing from requests JSON object";
+			JSONException ex(info);
+			throw ex;
+		}
+		if (!json_obj.contains("end")) {
+			string info = "End missing from requests JSON object";
+			JSONException ex(info);
+			throw ex;
+		}
+		json name_json = json_obj["name"];
+		if (!name_json.is_string()) {
+			string info = "Name is not a string";
+			JSONException ex(info);
+			throw ex;
+		}
+		*ret_name = name_json;
+
+		json start_json = json_obj["start"];
+		json end_json = json_obj["end"];
+		int x[2];
+		int y[2];
+		json* coordinates_to_process[] = { &start_json, &end_json };
+		for (int i = 0; i < 2; i++) {
+			json& coord_json = *coordinates_to_process[i];
+			process_coordinate_json(coord_json, &x[i], &y[i]);
+		}
+		*start_x = x[0];
+		*start_y = y[0];
+		*end_x = x[1];
+		*end_y = y[1];
+	}
+
+	void process_timed_request_json(json& json_obj, int* ret_time, string* ret_name, int* start_x, int* start_y, int* end_x, int* end_y)
+	{
+		if (!json_obj.is_object() || !json_obj.contains("t")) {
+			string info = "Time missing from requests JSON object";
+			JSONException ex(info);
+			throw ex;
+		}
+		json& time_json = json_obj["t"];
+		if (!time_json.is_number_integer() || time_json.get<long long>() < 0 || time_json.get<long long>() > INT_MAX) {
+			string info = "Time is not a non-negative integer";
+			JSONException ex(info);
+			throw ex;
+		}
+		*ret_time = time_json.get<int>();
+		process_request_json(json_obj, ret_name, start_x, start_y, end_x, end_y);
+	}
+
+	void process_coordinate_json(json& json_obj, int* ret_x, int* ret_y) {
+		if (!json_obj.is_array()) {
+			string info = "Coordinate is not array";
+			JSONException ex(info);
+			throw ex;
+		}
+		if (json_obj.size() != 2) {
+			string info = "Coordinate does not have exactly two elements";
+			JSONException ex(info);
+			throw ex;
+		}
+		int* ret_values[] = { ret_x, ret_y };
+		for (int i = 0; i < 2; i++) {
+			json& value_json = json_obj[i];
+			if (!value_json.is_number_integer() || value_json.get<long long>() < INT_MIN || value_json.get<long long>() > INT_MAX) {
+				string info = "Coordinate is not an integer";
+				JSONException ex(info);
+				throw ex;
+			}
+			*ret_values[i] = value_json.get<int>();
+		}
+	}
+
+	void process_request_json(json& json_obj, RideRequest* ret_request) {
+		string name;
+		int start_x, start_y, end_x, end_y;
+		process_request_json(json_obj, &name, &start_x, &start_y, &end_x, &end_y);
+		if (!ret_request->set(name.c_str(), start_x, start_y, end_x, end_y)) {
+			string info = "Name is longer than " + to_string(RideRequest::kMaxNameLength) + " characters";
+			JSONException ex(info);
+			throw ex;
+		}
+	}
+
+}  // namespace ride_share
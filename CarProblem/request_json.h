@@ -0,0 +1,52 @@
+/**
+ * @file request_json.h
+ * @author Ryan McMahon (mcmahonryan@hotmail.com)
+ * @brief Parsing of ride requests in the {name, start, end} JSON schema.
+ */
+#pragma once
+#include <string>
+#include "nlohmann/json.hpp"
+#include "ride_request.h"
+
+using namespace std;
+using json = nlohmann::json;
+
+/// @brief Exception thrown when a JSON ride-request file is malformed or semantically invalid.
+class JSONException {
+public:
+	JSONException() {
+		info_ = "";
+	}
+	JSONException(const char* info) {
+		info_ = info;
+	}
+	JSONException(const string& info) {
+		info_ = info;
+	}
+	string get_info() { return info_; }
+private:
+	string info_;
+};
+
+namespace ride_share {
+
+	/// @brief Parses a single ride-request JSON object into its component fields.
+	void process_request_json(json& json_obj, string* ret_name, int* start_x, int* start_y, int* end_x, int* end_y);
+
+	/// @brief Parses a JSON coordinate array [x, y] into integer components. Throws JSONException unless
+	///        the array holds exactly two integers that fit in an int.
+	void process_coordinate_json(json& json_obj, int* ret_x, int* ret_y);
+
+	/// @brief Parses a ride-request JSON object with an explicit arrival step in its "t" field.
+	///
+	/// Applies the checks of process_request_json(), and also throws JSONException unless "t" is present
+	/// and a non-negative integer.
+	void process_timed_request_json(json& json_obj, int* ret_time, string* ret_name, int* start_x, int* start_y, int* end_x, int* end_y);
+
+	/// @brief Parses a single ride-request JSON object into @p ret_request.
+	///
+	/// Performs the checks of the overload above, and also throws JSONException if the name is longer
+	/// than RideRequest::kMaxNameLength.
+	void process_request_json(json& json_obj, RideRequest* ret_request);
+
+}  // namespace ride_share
@@ -0,0 +1,66 @@
+/**
+ * @file request_queue.cpp
+ * @author Ryan McMahon (mcmahonryan@hotmail.com)
+ */
+#include "request_queue.h"
+
+namespace ride_share {
+
+	RequestQueue::RequestQueue(int capacity) {
+		size_t size = 2;
+		while (size < (size_t)capacity) {
+			size *= 2;
+		}
+		cells_.reset(new Cell[size]);
+		mask_ = size - 1;
+		for (size_t i = 0; i < size; i++) {
+			cells_[i].sequence_.store(i, memory_order_relaxed);
+		}
+		enqueue_pos_.store(0, memory_order_relaxed);
+		dequeue_pos_ = 0;
+	}
+
+	bool RequestQueue::push(const RideRequest& request) {
+		// A cell is free for position pos when its sequence equals pos; one lap behind means the ring is full.
+		size_t pos = enqueue_pos_.load(memory_order_relaxed);
+		Cell* cell;
+		for (;;) {
+			cell = &cells_[pos & mask_];
+			size_t sequence = cell->sequence_.load(memory_order_acquire);
+			ptrdiff_t diff = (ptrdiff_t)sequence - (ptrdiff_t)pos;
+			if (diff == 0) {
+				if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) {
+					break;
+				}
+			}
+			else if (diff < 0) {
+				return false;
+			}
+			else {
+				pos = enqueue_pos_.load(memory_order_relaxed);
+			}
+		}
+		cell->request_ = request;
+		cell->sequence_.store(pos + 1, memory_order_release);
+		return true;
+	}
+
+	bool RequestQueue::pop(RideRequest* ret_request) {
+		Cell* cell = &cells_[dequeue_pos_ & mask_];
+		size_t sequence = cell->sequence_.load(memory_order_acquire);
+		if (sequence != dequeue_pos_ + 1) {
+			return false;
+		}
+		*ret_request = cell->request_;
+		// Hand the cell to whichever producer reaches this index on the next lap.
+		cell->sequence_.store(dequeue_pos_ + mask_ + 1, memory_order_release);
+		dequeue_pos_++;
+		return true;
+	}
+
+	bool RequestQueue::is_empty() const {
+		const Cell* cell = &cells_[dequeue_pos_ & mask_];
+		return cell->sequence_.load(memory_order_acquire) != dequeue_pos_ + 1;
+	}
+
+}  // namespace ride_share
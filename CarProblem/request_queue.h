@@ -0,0 +1,57 @@
+/**
+ * @file request_queue.h
+ * @author Ryan McMahon (mcmahonryan@hotmail.com)
+ * @brief Bounded lock-free multi-producer, single-consumer queue of ride requests.
+ */
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include "ride_request.h"
+
+namespace ride_share {
+
+	using namespace std;
+
+	/// @brief Bounded ring that any number of threads push RideRequests into and one thread drains.
+	///
+	/// Each cell carries a sequence number that says whose turn it is. Producers claim a position with
+	/// a single compare-and-swap and publish the cell by bumping its sequence, so they never take a lock
+	/// and never wait for one another beyond a CAS retry. The consumer (the thread running
+	/// Dispatcher::update) needs no atomic read-modify-write at all. A request is only visible once its
+	/// producer has finished writing it, so a producer descheduled mid-push briefly holds back the
+	/// requests queued after it.
+	class RequestQueue {
+	public:
+		/// @param capacity Minimum number of requests the ring can hold; rounded up to a power of two.
+		explicit RequestQueue(int capacity);
+		RequestQueue(const RequestQueue&) = delete;
+		RequestQueue& operator=(const RequestQueue&) = delete;
+
+		/// @brief Enqueues a copy of @p request. Safe to call from any thread.
+		/// @return False if the ring is full.
+		bool push(const RideRequest& request);
+
+		/// @brief Dequeues the oldest request. Only the consumer thread may call this.
+		/// @return False if no request is ready.
+		bool pop(RideRequest* ret_request);
+
+		/// @brief Returns true if pop() would find nothing. Only the consumer thread may call this.
+		bool is_empty() const;
+
+		int get_capacity() const { return (int)(mask_ + 1); }
+
+	private:
+		struct Cell {
+			atomic<size_t> sequence_;
+			RideRequest request_;
+		};
+
+		unique_ptr<Cell[]> cells_;
+		size_t mask_;
+		/// Kept on separate cache lines so producers and the consumer don't invalidate each other.
+		alignas(64) atomic<size_t> enqueue_pos_;
+		alignas(64) size_t dequeue_pos_;
+	};
+
+}  // namespace ride_share
@@ -0,0 +1,394 @@
+/**
+ * @file request_server.cpp
+ * @author Ryan McMahon (mcmahonryan@hotmail.com)
+ */
+#include "request_server.h"
+#include "request_json.h"
+
+#if RIDE_SHARE_HAS_UNIX_SOCKETS
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace ride_share {
+
+	/// A client whose unsent output grows past this is too slow to keep up and is disconnected.
+	static const size_t kMaxClientBacklog = 1 << 20;
+
+	/// Collects one tick's events as the JSON line sent to subscribers.
+	class TickEventSink : public DispatchEventSink {
+	public:
+		void clear() {
+			pickups_ = json::array();
+			dropoffs_ = json::array();
+		}
+		void on_car_moved(const Point& car_pos, int time) override { car_pos_ = car_pos; }
+		void on_pickup(PassengerData* passenger) override { pickups_.push_back(passenger->get_name().c_str()); }
+		void on_drop_off(PassengerData* passenger) override { dropoffs_.push_back(passenger->get_name().c_str()); }
+		string get_line(int tick) {
+			json line;
+			line["tick"] = tick;
+			line["car"] = { car_pos_.x(), car_pos_.y() };
+			line["pickups"] = pickups_;
+			line["dropoffs"] = dropoffs_;
+			return line.dump() + "\n";
+		}
+	private:
+		Point car_pos_;
+		json pickups_;
+		json dropoffs_;
+	};
+
+	RequestServer::RequestServer(const CityGrid& grid, const string& socket_path, chrono::milliseconds tick_period) :
+		dispatcher_(grid),
+		socket_path_(socket_path),
+		tick_period_(tick_period),
+		listen_fd_(-1),
+		wake_read_fd_(-1),
+		wake_write_fd_(-1),
+		stop_requested_(false)
+	{
+		dispatcher_.set_idle_retirement(kIdleRetirementTicks);
+		num_ticks_ = 0;
+		num_requests_ = 0;
+		num_errors_ = 0;
+	}
+
+	RequestServer::~RequestServer() {
+		close_sockets();
+	}
+
+#if RIDE_SHARE_HAS_UNIX_SOCKETS
+
+	/// @brief Throws a ServerException describing the failed call and errno.
+	static void throw_socket_error(const char* what) {
+		string info = string(what) + " failed: " + strerror(errno);
+		ServerException ex(info);
+		throw ex;
+	}
+
+	static void set_non_blocking(int fd) {
+		fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+	}
+
+	void RequestServer::start() {
+		sockaddr_un address;
+		memset(&address, 0, sizeof(address));
+		address.sun_family = AF_UNIX;
+		if (socket_path_.size() >= sizeof(address.sun_path)) {
+			string info = "Socket path is too long: " + socket_path_;
+			ServerException ex(info);
+			throw ex;
+		}
+		strcpy(address.sun_path, socket_path_.c_str());
+
+		int wake_fds[2];
+		if (pipe(wake_fds) != 0) {
+			throw_socket_error("pipe");
+		}
+		set_non_blocking(wake_fds[0]);
+		set_non_blocking(wake_fds[1]);
+		wake_read_fd_ = wake_fds[0];
+		wake_write_fd_ = wake_fds[1];
+
+		listen_fd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (listen_fd_ < 0) {
+			throw_socket_error("socket");
+		}
+		unlink(socket_path_.c_str());
+		if (::bind(listen_fd_, (sockaddr*)&address, sizeof(address)) != 0) {
+			throw_socket_error("bind");
+		}
+		if (listen(listen_fd_, SOMAXCONN) != 0) {
+			throw_socket_error("listen");
+		}
+		set_non_blocking(listen_fd_);
+	}
+
+	void RequestServer::run() {
+		typedef chrono::steady_clock Clock;
+		vector<pollfd> poll_fds;
+		Clock::time_point deadline = Clock::now() + tick_period_;
+
+		while (!stop_requested_.load()) {
+			poll_fds.clear();
+			poll_fds.push_back({ wake_read_fd_, POLLIN, 0 });
+			poll_fds.push_back({ listen_fd_, POLLIN, 0 });
+			for (size_t i = 0; i < clients_.size(); i++) {
+				short events = POLLIN;
+				if (!clients_[i]->write_buffer_.empty()) {
+					events |= POLLOUT;
+				}
+				poll_fds.push_back({ clients_[i]->fd_, events, 0 });
+			}
+
+			// Round the wait up, so the tick is never run early.
+			Clock::duration remaining = deadline - Clock::now();
+			int timeout_ms = 0;
+			if (remaining > Clock::duration::zero()) {
+				timeout_ms = (int)chrono::ceil<chrono::milliseconds>(remaining).count();
+			}
+			if (poll(poll_fds.data(), (nfds_t)poll_fds.size(), timeout_ms) < 0 && errno != EINTR) {
+				throw_socket_error("poll");
+			}
+
+			if (poll_fds[1].revents & POLLIN) {
+				accept_clients();
+			}
+			// Clients accepted just now have no entry in poll_fds; they are polled from the next pass.
+			for (size_t i = 2; i < poll_fds.size(); i++) {
+				Client& client = *clients_[i - 2];
+				if (poll_fds[i].revents & (POLLIN | POLLHUP | POLLERR)) {
+					read_client(client);
+				}
+				if (!client.closed_ && (poll_fds[i].revents & POLLOUT)) {
+					flush_client(client);
+				}
+			}
+
+			Clock::time_point now = Clock::now();
+			if (now >= deadline) {
+				run_tick();
+				deadline += tick_period_;
+				// After a long stall, start a fresh schedule rather than bursting through the missed ticks.
+				if (now - deadline > tick_period_ * 5) {
+					deadline = now + tick_period_;
+				}
+			}
+			remove_closed_clients();
+		}
+
+		// Drain the wake-up pipe so a later run() doesn't return immediately.
+		char buffer[64];
+		while (read(wake_read_fd_, buffer, sizeof(buffer)) > 0) {
+		}
+	}
+
+	void RequestServer::stop() {
+		stop_requested_ = true;
+		int wake_fd = wake_write_fd_.load();
+		if (wake_fd >= 0) {
+			char wake = 1;
+			ssize_t written = write(wake_fd, &wake, 1);
+			(void)written;
+		}
+	}
+
+	void RequestServer::accept_clients() {
+		for (;;) {
+			int fd = accept(listen_fd_, nullptr, nullptr);
+			if (fd < 0) {
+				return;
+			}
+			set_non_blocking(fd);
+#ifdef SO_NOSIGPIPE
+			int on = 1;
+			setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+			unique_ptr<Client> client(new Client());
+			client->fd_ = fd;
+			client->subscribed_ = false;
+			client->closed_ = false;
+			clients_.push_back(move(client));
+		}
+	}
+
+	void RequestServer::read_client(Client& client) {
+		// Lines are handled as each chunk arrives, so the buffer never holds more than one unfinished
+		// line plus a chunk, however much the client sends.
+		char buffer[4096];
+		while (!client.closed_) {
+			ssize_t num_read = recv(client.fd_, buffer, sizeof(buffer), 0);
+			if (num_read <= 0) {
+				if (num_read == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+					client.closed_ = true;
+				}
+				break;
+			}
+			client.read_buffer_.append(buffer, (size_t)num_read);
+
+			size_t line_start = 0;
+			size_t line_end;
+			while (!client.closed_ && (line_end = client.read_buffer_.find('\n', line_start)) != string::npos) {
+				handle_line(client, client.read_buffer_.substr(line_start, line_end - line_start));
+				line_start = line_end + 1;
+			}
+			client.read_buffer_.erase(0, line_start);
+			if (client.read_buffer_.size() > kMaxLineLength) {
+				client.closed_ = true;
+			}
+		}
+	}
+
+	void RequestServer::handle_line(Client& client, const string& line) {
+		if (line.find_first_not_of(" \t\r") == string::npos) {
+			return;
+		}
+		json line_json = json::parse(line, nullptr, false);
+		PendingRequest pending;
+		pending.client_ = &client;
+		try {
+			if (line_json.is_discarded() || !line_json.is_object()) {
+				string info = "Request is not a JSON object";
+				JSONException ex(info);
+				throw ex;
+			}
+			if (line_json.contains("subscribe")) {
+				client.subscribed_ = line_json["subscribe"].is_boolean() && line_json["subscribe"].get<bool>();
+				return;
+			}
+			process_request_json(line_json, &pending.request_);
+			if (pending_requests_.size() >= kMaxPendingRequests) {
+				string info = "Server is busy";
+				JSONException ex(info);
+				throw ex;
+			}
+		}
+		catch (JSONException e) {
+			json error;
+			error["error"] = e.get_info();
+			if (pending.request_.get_name()[0] != '\0') {
+				error["name"] = pending.request_.get_name();
+			}
+			send_line(client, error.dump() + "\n");
+			num_errors_++;
+			return;
+		}
+		pending_requests_.push_back(pending);
+	}
+
+	void RequestServer::run_tick() {
+		// Ticks are numbered from 1, matching the dispatcher's clock after the step.
+		int tick = num_ticks_ + 1;
+		for (size_t i = 0; i < pending_requests_.size(); i++) {
+			PendingRequest& pending = pending_requests_[i];
+			const RideRequest& request = pending.request_;
+			json reply;
+			try {
+				dispatcher_.new_request(request.get_name(), request.get_start_x(), request.get_start_y(), request.get_end_x(), request.get_end_y());
+				reply["ack"] = request.get_name();
+				reply["tick"] = tick;
+				num_requests_++;
+			}
+			catch (PassengerException e) {
+				reply["error"] = e.get_info();
+				reply["name"] = request.get_name();
+				num_errors_++;
+			}
+			if (pending.client_) {
+				send_line(*pending.client_, reply.dump() + "\n");
+			}
+		}
+		pending_requests_.clear();
+
+		TickEventSink sink;
+		sink.clear();
+		dispatcher_.update(sink);
+		num_ticks_++;
+
+		string line;
+		for (size_t i = 0; i < clients_.size(); i++) {
+			if (clients_[i]->subscribed_ && !clients_[i]->closed_) {
+				if (line.empty()) {
+					line = sink.get_line(tick);
+				}
+				send_line(*clients_[i], line);
+			}
+		}
+	}
+
+	void RequestServer::send_line(Client& client, const string& line) {
+		if (client.closed_) {
+			return;
+		}
+		client.write_buffer_ += line;
+		flush_client(client);
+		if (client.write_buffer_.size() > kMaxClientBacklog) {
+			client.closed_ = true;
+		}
+	}
+
+	void RequestServer::flush_client(Client& client) {
+#ifdef MSG_NOSIGNAL
+		const int flags = MSG_NOSIGNAL;
+#else
+		const int flags = 0;
+#endif
+		size_t sent_total = 0;
+		while (sent_total < client.write_buffer_.size()) {
+			ssize_t sent = send(client.fd_, client.write_buffer_.data() + sent_total, client.write_buffer_.size() - sent_total, flags);
+			if (sent < 0) {
+				if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+					client.closed_ = true;
+				}
+				break;
+			}
+			sent_total += (size_t)sent;
+		}
+		client.write_buffer_.erase(0, sent_total);
+	}
+
+	void RequestServer::remove_closed_clients() {
+		size_t write_index = 0;
+		for (size_t i = 0; i < clients_.size(); i++) {
+			if (!clients_[i]->closed_) {
+				clients_[write_index++] = move(clients_[i]);
+				continue;
+			}
+			for (size_t p = 0; p < pending_requests_.size(); p++) {
+				if (pending_requests_[p].client_ == clients_[i].get()) {
+					pending_requests_[p].client_ = nullptr;
+				}
+			}
+			close(clients_[i]->fd_);
+		}
+		clients_.resize(write_index);
+	}
+
+	void RequestServer::close_sockets() {
+		for (size_t i = 0; i < clients_.size(); i++) {
+			close(clients_[i]->fd_);
+		}
+		clients_.clear();
+		if (listen_fd_ >= 0) {
+			close(listen_fd_);
+			unlink(socket_path_.c_str());
+			listen_fd_ = -1;
+		}
+		int wake_fd = wake_write_fd_.exchange(-1);
+		if (wake_fd >= 0) {
+			close(wake_fd);
+		}
+		if (wake_read_fd_ >= 0) {
+			close(wake_read_fd_);
+			wake_read_fd_ = -1;
+		}
+	}
+
+#else
+
+	void RequestServer::start() {
+		string info = "Unix domain sockets are not supported on this platform";
+		ServerException ex(info);
+		throw ex;
+	}
+
+	void RequestServer::run() {
+		start();
+	}
+
+	void RequestServer::stop() {
+		stop_requested_ = true;
+	}
+
+	void RequestServer::close_sockets() {
+	}
+
+#endif
+
+}  // namespace ride_share
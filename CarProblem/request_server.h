@@ -0,0 +1,132 @@
+/**
+ * @file request_server.h
+ * @author Ryan McMahon (mcmahonryan@hotmail.com)
+ * @brief Unix-domain-socket server that feeds JSON-lines ride requests to a dispatcher.
+ */
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include "dispatcher.h"
+#include "ride_request.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define RIDE_SHARE_HAS_UNIX_SOCKETS 1
+#else
+#define RIDE_SHARE_HAS_UNIX_SOCKETS 0
+#endif
+
+namespace ride_share {
+
+	using namespace std;
+
+	/// @brief Exception thrown when a socket cannot be created, bound or connected.
+	class ServerException {
+	public:
+		ServerException() {
+			info_ = "";
+		}
+		ServerException(const char* info) {
+			info_ = info;
+		}
+		ServerException(const string& info) {
+			info_ = info;
+		}
+		string get_info() { return info_; }
+	private:
+		string info_;
+	};
+
+	/// @brief Serves one dispatcher over a Unix domain socket, one JSON object per line.
+	///
+	/// Clients send ride requests in the same {"name", "start", "end"} schema as the scenario files.
+	/// Requests that arrive during a tick are held and submitted together at the start of the next one;
+	/// each is then answered with {"ack": name, "tick": t}, or {"error": info, "name": name} if it was
+	/// rejected. A client that sends {"subscribe": true} also receives one line per tick:
+	/// {"tick": t, "car": [x, y], "pickups": [...], "dropoffs": [...]}.
+	///
+	/// Everything runs on the thread that calls run(), driven by poll(), so the dispatcher is never
+	/// shared. Only available where Unix domain sockets are; elsewhere start() throws.
+	///
+	/// Clients can't make the server grow without bound: a line longer than kMaxLineLength gets the
+	/// client disconnected, a request arriving while kMaxPendingRequests are already waiting for the
+	/// tick is answered {"error": "Server is busy", "name": name} straight away, and passengers are
+	/// retired after kIdleRetirementTicks idle ticks.
+	class RequestServer {
+	public:
+		/// @brief Longest input line accepted before the client is disconnected.
+		static const size_t kMaxLineLength = 4096;
+
+		/// @brief Most requests held for the next tick, across all clients.
+		static const size_t kMaxPendingRequests = 4096;
+
+		/// @brief Ticks after a drop-off before an idle passenger is retired.
+		static const int kIdleRetirementTicks = 600;
+
+		/// @param grid City to serve.
+		/// @param socket_path Filesystem path of the socket. An existing file there is replaced.
+		/// @param tick_period Wall-clock time between dispatcher steps.
+		RequestServer(const CityGrid& grid, const string& socket_path, chrono::milliseconds tick_period);
+		~RequestServer();
+		RequestServer(const RequestServer&) = delete;
+		RequestServer& operator=(const RequestServer&) = delete;
+
+		/// @brief Creates the socket and starts listening. Throws ServerException on failure.
+		void start();
+
+		/// @brief Serves clients and runs ticks until stop() is called. start() must have succeeded.
+		void run();
+
+		/// @brief Makes run() return. Safe to call from any thread, including before run() starts.
+		void stop();
+
+		int get_num_ticks() const { return num_ticks_; }
+		long long get_num_requests() const { return num_requests_; }
+		long long get_num_errors() const { return num_errors_; }
+
+	private:
+		/// One connection, with its unparsed input and unsent output.
+		struct Client {
+			int fd_;
+			string read_buffer_;
+			string write_buffer_;
+			bool subscribed_;
+			bool closed_;
+		};
+
+		/// A request waiting for the next tick. @p client_ is cleared if the client disconnects first.
+		struct PendingRequest {
+			Client* client_;
+			RideRequest request_;
+		};
+
+		void accept_clients();
+		void read_client(Client& client);
+		void handle_line(Client& client, const string& line);
+		void run_tick();
+		void send_line(Client& client, const string& line);
+		void flush_client(Client& client);
+		void remove_closed_clients();
+		void close_sockets();
+
+		Dispatcher dispatcher_;
+		string socket_path_;
+		chrono::milliseconds tick_period_;
+		int listen_fd_;
+		/// Self-pipe that stop() writes to, so it can wake a thread blocked in poll(). The write end is
+		/// atomic because stop() may read it from another thread while start() is setting it up.
+		int wake_read_fd_;
+		atomic<int> wake_write_fd_;
+		atomic<bool> stop_requested_;
+
+		vector<unique_ptr<Client>> clients_;
+		vector<PendingRequest> pending_requests_;
+
+		int num_ticks_;
+		long long num_requests_;
+		long long num_errors_;
+	};
+
+}  // namespace ride_share
@@ -0,0 +1,52 @@
+/**
+ * @file ride_request.h
+ * @author Ryan McMahon (mcmahonryan@hotmail.com)
+ * @brief Fixed-size ride request record.
+ */
+#pragma once
+#include <cstring>
+#include "point.h"
+
+namespace ride_share {
+
+	/// @brief One ride request as plain, fixed-size data.
+	///
+	/// Trivially copyable, with the name stored inline, so requests can be queued, batched and
+	/// handed between threads without allocating.
+	class RideRequest {
+	public:
+		/// @brief Longest name a request can carry, not counting the terminator.
+		static const int kMaxNameLength = 31;
+
+		RideRequest() : start_x_(0), start_y_(0), end_x_(0), end_y_(0) { name_[0] = '\0'; }
+
+		/// @brief Fills in every field.
+		/// @return False (leaving the request unchanged) if @p name is longer than kMaxNameLength.
+		bool set(const char* name, int start_x, int start_y, int end_x, int end_y) {
+			size_t length = strlen(name);
+			if (length > (size_t)kMaxNameLength) {
+				return false;
+			}
+			memcpy(name_, name, length + 1);
+			start_x_ = start_x;
+			start_y_ = start_y;
+			end_x_ = end_x;
+			end_y_ = end_y;
+			return true;
+		}
+
+		const char* get_name() const { return name_; }
+		int get_start_x() const { return start_x_; }
+		int get_start_y() const { return start_y_; }
+		int get_end_x() const { return end_x_; }
+		int get_end_y() const { return end_y_; }
+
+	private:
+		char name_[kMaxNameLength + 1];
+		int start_x_;
+		int start_y_;
+		int end_x_;
+		int end_y_;
+	};
+
+}  // namespace ride_share
@@ -5,9 +5,33 @@
 #include <iostream>
 #include <fstream>
 #include <filesystem>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <thread>
 #include <stdlib.h>
 #include <time.h>
 #include "dispatcher.h"
+#include "allocation_counter.h"
+#include "simulation_arena.h"
+#include "dispatcher_snapshot.h"
+#include "request_queue.h"
+#include "latency_recorder.h"
+#include "tick_scheduler.h"
+#include "request_server.h"
+#include "load_generator.h"
+#include "tick_event_ring.h"
+#include "scenario_scheduler.h"
+#include "city_host.h"
+#include "scenario_stream.h"
+#include "mapped_file.h"
+#include "ride_trace.h"
+#include "scenario_lines.h"
+#include "scenario_cache.h"
 #include "ride_share_tester.h"
 
 using namespace ride_share;
@@ -15,8 +39,182 @@ using namespace std;
 // Note: On Visual Studio, this only works if the language standard is ISO C++ 17
 namespace fs = std::filesystem;
 
-RideShareTester::RideShareTester() {
+void StepEventLog::clear() {
+	pickups_.clear();
+	dropoffs_.clear();
+}
+
+/// @brief Returns a socket path in the temp directory that no other run is using.
+static string make_socket_path(const char* label) {
+	long long stamp = (long long)chrono::steady_clock::now().time_since_epoch().count();
+	fs::path path = fs::temp_directory_path() / (string("ride_share_") + label + "_" + to_string(stamp) + ".sock");
+	return path.string();
+}
+
+/// @brief Returns a request named @p name for a random ride in @p grid. The start and end are in different
+///        columns, so they never coincide.
+/// @param rng Anything callable that returns a random non-negative integer, such as minstd_rand or rand.
+template <class Rng>
+static RideRequest make_random_request(Rng& rng, const CityGrid& grid, const string& name) {
+	int start_x = rng() % grid.get_width();
+	int start_y = rng() % grid.get_height();
+	int end_x = (start_x + 1 + rng() % (grid.get_width() - 1)) % grid.get_width();
+	int end_y = rng() % grid.get_height();
+	RideRequest request;
+	request.set(name.c_str(), start_x, start_y, end_x, end_y);
+	return request;
+}
+
+/// @brief Submits @p request to @p dispatcher with Dispatcher::new_request().
+static PassengerHandle new_request(Dispatcher& dispatcher, const RideRequest& request) {
+	return dispatcher.new_request(request.get_name(), request.get_start_x(), request.get_start_y(), request.get_end_x(), request.get_end_y());
+}
+
+/// @brief Outcome of simulate_city(), compared between serial and parallel runs.
+struct CitySimulationResult {
+	int num_trips;
+	float avg_unhappiness;
+	float avg_trip_time;
+	int num_steps;
+};
+
+/// @brief Seeded random simulation as a resumable Scenario: one request (until the quota is met) and one step per tick.
+class RandomCityScenario : public Scenario {
+public:
+	RandomCityScenario(int city_size, unsigned int seed, int num_requests) :
+		rng_(seed),
+		dispatcher_(CityGrid(city_size, city_size)),
+		city_size_(city_size),
+		num_requests_(num_requests),
+		requests_made_(0)
+	{
+		result_.num_steps = 0;
+	}
+
+	ScenarioStatus resume() override {
+		if (dispatcher_.is_done()) {
+			dispatcher_.get_statistics(&result_.num_trips, &result_.avg_unhappiness, &result_.avg_trip_time);
+			return ScenarioStatus::Done;
+		}
+		if (requests_made_ < num_requests_) {
+			new_request(dispatcher_, make_random_request(rng_, dispatcher_.get_grid(), "Rider" + to_string(requests_made_)));
+			requests_made_++;
+		}
+		else {
+			dispatcher_.set_last_request_made();
+		}
+		dispatcher_.update();
+		result_.num_steps++;
+		return ScenarioStatus::WaitTick;
+	}
+
+	const CitySimulationResult& get_result() const { return result_; }
+
+private:
+	minstd_rand rng_;
+	Dispatcher dispatcher_;
+	int city_size_;
+	int num_requests_;
+	int requests_made_;
+	CitySimulationResult result_;
+};
+
+/// @brief Runs one seeded random simulation to completion. Touches no shared state, so it is safe to call from any thread.
+static CitySimulationResult simulate_city(int city_size, unsigned int seed, int num_requests) {
+	RandomCityScenario scenario(city_size, seed, num_requests);
+	while (scenario.resume() != ScenarioStatus::Done) {
+	}
+	return scenario.get_result();
+}
+
+/// @brief Scenario fed from outside, one batch of requests per tick, that waits whenever no batch has arrived.
+class FedCityScenario : public Scenario {
+public:
+	explicit FedCityScenario(const CityGrid& grid) :
+		dispatcher_(grid),
+		input_finished_(false),
+		feeding_(true)
+	{
+		result_.num_steps = 0;
+	}
+
+	/// @brief Queues the requests for one tick. Safe to call from any thread.
+	void feed(const vector<RideRequest>& batch) {
+		lock_guard<mutex> lock(mutex_);
+		batches_.push_back(batch);
+	}
+
+	/// @brief Returns true once every batch fed so far has been run. Safe to call from any thread.
+	bool is_input_consumed() {
+		lock_guard<mutex> lock(mutex_);
+		return batches_.empty();
+	}
+
+	/// @brief Says no more batches are coming. Safe to call from any thread.
+	void finish_input() {
+		lock_guard<mutex> lock(mutex_);
+		input_finished_ = true;
+	}
 
+	ScenarioStatus resume() override {
+		if (dispatcher_.is_done()) {
+			dispatcher_.get_statistics(&result_.num_trips, &result_.avg_unhappiness, &result_.avg_trip_time);
+			return ScenarioStatus::Done;
+		}
+		batch_.clear();
+		if (feeding_) {
+			lock_guard<mutex> lock(mutex_);
+			if (!batches_.empty()) {
+				batch_.swap(batches_.front());
+				batches_.pop_front();
+			}
+			else if (input_finished_) {
+				feeding_ = false;
+				dispatcher_.set_last_request_made();
+			}
+			else {
+				return ScenarioStatus::WaitInput;
+			}
+		}
+		for (size_t i = 0; i < batch_.size(); i++) {
+			const RideRequest& request = batch_[i];
+			dispatcher_.new_request(request.get_name(), request.get_start_x(), request.get_start_y(), request.get_end_x(), request.get_end_y());
+		}
+		dispatcher_.update();
+		result_.num_steps++;
+		return ScenarioStatus::WaitTick;
+	}
+
+	const CitySimulationResult& get_result() const { return result_; }
+
+private:
+	Dispatcher dispatcher_;
+	mutex mutex_;
+	deque<vector<RideRequest>> batches_;
+	bool input_finished_;
+	/// Only touched by resume().
+	bool feeding_;
+	vector<RideRequest> batch_;
+	CitySimulationResult result_;
+};
+
+/// @brief Returns @p num_batches seeded batches of zero to two requests each, for a FedCityScenario.
+static vector<vector<RideRequest>> make_request_batches(const CityGrid& grid, unsigned int seed, int num_batches) {
+	minstd_rand rng(seed);
+	vector<vector<RideRequest>> batches(num_batches);
+	int requests_made = 0;
+	for (int b = 0; b < num_batches; b++) {
+		int batch_size = rng() % 3;
+		for (int i = 0; i < batch_size; i++) {
+			batches[b].push_back(make_random_request(rng, grid, "Rider" + to_string(requests_made++)));
+		}
+	}
+	return batches;
+}
+
+RideShareTester::RideShareTester(const CityGrid& city_grid) :
+	city_grid_(city_grid)
+{
 }
 
 void RideShareTester::run_tests() {
@@ -25,6 +223,8 @@ void RideShareTester::run_tests() {
 	run_json_test("RideRequestsDoubleRequest.json", true);
 	run_json_test("RideRequestsBadCoordinate.json", true);
 	run_json_test("RideRequestsDuplicateCoordinate.json", true);
+	run_json_test("RideRequestsSparse.jsonl");
+	run_json_test("RideRequestsBadTimestamp.jsonl", true);
 
 	for (int bad_json_index = 1; bad_json_index <= 3; bad_json_index++) {
 		string filename = "RideRequestsBadJSON" + to_string(bad_json_index) + ".json";
@@ -34,6 +234,42 @@ void RideShareTester::run_tests() {
 	run_random_test("Random test 1", 15, 2, 500, false);
 	run_random_test("Random test 2", 10, 5, 500, false);
 	run_random_test("Random test 3", 10, 15, 500, false);
+
+	run_retirement_test(2000, 20);
+	run_allocation_test(300);
+	run_arena_test(200, 50);
+	run_parallel_city_test(16);
+	run_small_city_board_test(20000);
+	run_snapshot_test(2000, 4);
+	run_request_queue_test(4, 500);
+	run_tick_scheduler_test(30, 2);
+	run_request_server_test(4, 25);
+	run_request_server_limits_test();
+	run_tick_event_ring_test(500, 64);
+	run_car_state_test(2000000, 3);
+	run_scenario_scheduler_test(2000, 100, 4);
+	run_city_host_test(12, 4, 300);
+	run_eta_test(30);
+	run_bulk_eta_test(200);
+	run_admission_test(20, 40);
+	run_scenario_stream_test(20000);
+	run_mapped_file_test(2000);
+	run_ride_trace_test();
+	run_scenario_lines_test();
+	run_scenario_cache_test();
+}
+
+void RideShareTester::run_benchmarks() {
+	run_request_queue_benchmark(1, 400000);
+	run_request_queue_benchmark(2, 200000);
+	run_request_queue_benchmark(4, 100000);
+	run_request_queue_benchmark(8, 50000);
+	run_request_server_benchmark(1, 1000);
+	run_request_server_benchmark(8, 125);
+	run_bulk_eta_benchmark(100000, 1000);
+	run_scenario_load_benchmark(1000000);
+	run_ride_trace_benchmark(1000000);
+	run_scenario_cache_benchmark(1000000);
 }
 
 void RideShareTester::run_json_test(const char* json_file, bool should_fail) {
@@ -52,6 +288,14 @@ void RideShareTester::run_json_test(const char* json_file, bool should_fail) {
 		info = e.get_info();
 		failed = true;
 	}
+	catch (MappedFileException e) {
+		info = e.get_info();
+		failed = true;
+	}
+	catch (TraceException e) {
+		info = e.get_info();
+		failed = true;
+	}
 	if (should_fail != failed) {
 		cout << "----------------------------" << endl;
 		if (failed) {
@@ -72,54 +316,46 @@ void RideShareTester::run_json_test(const char* json_file, bool should_fail) {
 }
 
 void RideShareTester::load_and_run_json(const char* json_file) {
-	json j;
-	load_json_file(json_file, j);
+	string json_path = get_json_path(json_file).string();
 
-	Dispatcher dispatcher;
+	Dispatcher dispatcher(city_grid_);
+	StepEventLog events;
 	int t = 0;
-	json::iterator it = j.begin();
-	// Main update loop for advancing through the scenario.
-	while (!dispatcher.is_done()) {
-
-		if (it != j.end()) {
-			if (!it->contains("requests")) {
-				string info = "Missing requests object in JSON";
-				JSONException ex(info);
-				throw ex;
-			}
-
-			json& requests_json = *(it->find("requests"));
-			for (json::iterator request_it = requests_json.begin(); request_it != requests_json.end(); request_it++) {
-				string name;
-				int start_x, start_y, end_x, end_y;
-				process_request_json(*request_it, &name, &start_x, &start_y, &end_x, &end_y);
-
-				dispatcher.new_request(name.c_str(), start_x, start_y, end_x, end_y);
-			}
-			it++;
-		}
-		else {
-			dispatcher.set_last_request_made();
-		}
-
-		vector<PassengerData*> in_car;
-		dispatcher.get_passengers_in_car(in_car);
-		vector<PassengerData*> pickups;
-		vector<PassengerData*> dropoffs;
-		dispatcher.update(pickups, dropoffs);
+	// Each step's requests are submitted as soon as they are parsed; this runs the rest of the step.
+	function<void()> step = [&]() {
+		// The in-car list changes during update(), so capture it first.
+		string in_car_str = get_passenger_list_str(dispatcher.get_passengers_in_car(), "None");
+		events.clear();
+		dispatcher.update(events);
 		Point car_pos = dispatcher.get_car_pos();
 		std::cout << "Time step: " << to_string(t) << ", car at: " << car_pos.get_string() << endl;
 
-		std::cout << "Current passengers: " << get_passenger_list_str(in_car, "None") << endl;
-		if (pickups.size() > 0) {
-			std::cout << "Pickups: " << get_passenger_list_str(pickups, nullptr) << endl;
+		std::cout << "Current passengers: " << in_car_str << endl;
+		if (events.get_pickups().size() > 0) {
+			std::cout << "Pickups: " << get_passenger_list_str(events.get_pickups(), nullptr) << endl;
 		}
-		if (dropoffs.size() > 0) {
-			std::cout << "Dropoffs: " << get_passenger_list_str(dropoffs, nullptr) << endl;
+		if (events.get_dropoffs().size() > 0) {
+			std::cout << "Dropoffs: " << get_passenger_list_str(events.get_dropoffs(), nullptr) << endl;
 		}
 
 		t++;
+	};
+	if (!scenario_cache_dir_.empty()) {
+		replay_scenario_cached(json_path, scenario_cache_dir_, dispatcher, step);
+	}
+	else {
+		MappedFile file(json_path);
+		// .jsonl files hold one timestamped request per line; anything else is an array of steps.
+		if (fs::path(json_file).extension() == ".jsonl") {
+			ScenarioLinesReader reader(dispatcher, step);
+			reader.run(file.get_data(), file.get_size());
+		}
+		else {
+			ScenarioStreamReader reader(dispatcher, step);
+			reader.run(file.get_data(), file.get_size());
+		}
 	}
+
 	std::cout << endl << "JSON test complete for " << json_file << endl;
 	int num_trips;
 	float avg_unhappiness;
@@ -128,80 +364,17 @@ void RideShareTester::load_and_run_json(const char* json_file) {
 	std::cout << "Total trips: " << to_string(num_trips) << ", average unhappiness: " << to_string(avg_unhappiness) << ", average trip time: " << to_string(avg_trip_time) << endl;
 }
 
-void RideShareTester::load_json_file(const char* filename, json& json_obj) {
+fs::path RideShareTester::get_json_path(const char* filename) {
 	fs::path current_path = fs::current_path();
 	fs::path json_path(filename);
 	fs::path full_path = current_path;
 	full_path /= "data";
 	full_path /= json_path;
 	std::cout << "JSON path is: " << full_path << endl;
-	ifstream filestream(full_path);
-	filestream >> json_obj;
-}
-
-void RideShareTester::process_request_json(json& json_obj, string* ret_name, int* start_x, int* start_y, int* end_x, int* end_y)
-{
-	if (!json_obj.contains("name")) {
-		string info = "Name missing from requests JSON object";
-		JSONException ex(info);
-		throw ex;
-	}
-	if (!json_obj.contains("start")) {
-		string info = "Start missing from requests JSON object";
-		JSONException ex(info);
-		throw ex;
-	}
-	if (!json_obj.contains("end")) {
-		string info = "End missing from requests JSON object";
-		JSONException ex(info);
-		throw ex;
-	}
-	json name_json = json_obj["name"];
-	if (!name_json.is_string()) {
-		string info = "Name is not a string";
-		JSONException ex(info);
-		throw ex;
-	}
-	*ret_name = name_json;
-
-	json start_json = json_obj["start"];
-	json end_json = json_obj["end"];
-	int x[2];
-	int y[2];
-	json* coordinates_to_process[] = { &start_json, &end_json };
-	for (int i = 0; i < 2; i++) {
-		json& coord_json = *coordinates_to_process[i];
-		process_coordinate_json(coord_json, &x[i], &y[i]);
-	}
-	*start_x = x[0];
-	*start_y = y[0];
-	*end_x = x[1];
-	*end_y = y[1];
-}
-
-void RideShareTester::process_coordinate_json(json& json_obj, int* ret_x, int* ret_y) {
-	if (!json_obj.is_array()) {
-		string info = "Coordinate is not array";
-		JSONException ex(info);
-		throw ex;
-	}
-	int which_coord = 0;
-	for (json::iterator it = json_obj.begin(); it != json_obj.end(); it++) {
-		int val = 0;
-		if (it->is_number()) {
-			val = *it;
-		}
-		if (which_coord == 0) {
-			*ret_x = val;
-		}
-		else {
-			*ret_y = val;
-		}
-		which_coord++;
-	}
+	return full_path;
 }
 
-string RideShareTester::get_passenger_list_str(vector<PassengerData*>& the_list, const char* if_empty_str) {
+string RideShareTester::get_passenger_list_str(const PassengerList& the_list, const char* if_empty_str) {
 	string out_str = "";
 	if (the_list.size() == 0 && if_empty_str) {
 		out_str = if_empty_str;
@@ -209,8 +382,8 @@ string RideShareTester::get_passenger_list_str(vector<PassengerData*>& the_list,
 	}
 
 	string comma_str = "";
-	for (vector<PassengerData*>::iterator it = the_list.begin(); it != the_list.end(); it++) {
-		out_str = out_str + comma_str + (*it)->get_name();
+	for (PassengerList::const_iterator it = the_list.begin(); it != the_list.end(); it++) {
+		out_str = out_str + comma_str + (*it)->get_name().c_str();
 		comma_str = ", ";
 	}
 	return out_str;
@@ -223,8 +396,8 @@ void RideShareTester::run_random_test(const char* test_name, int city_size, int
 	const char* names[] = { "Andy", "Betsy", "Charlie", "Danielle", "Emilio", "Francis", "George", "Heidi", "Igor", "Jamie" };
 	int num_names = 10;
 
-	Point::set_grid_dims(city_size, city_size);
-	Dispatcher dispatcher;
+	Dispatcher dispatcher(CityGrid(city_size, city_size));
+	StepEventLog events;
 	int t = 0;
 	// Main update loop for advancing through the scenario.
 	while (!dispatcher.is_done()) {
@@ -249,21 +422,20 @@ void RideShareTester::run_random_test(const char* test_name, int city_size, int
 			dispatcher.set_last_request_made();
 		}
 
-		vector<PassengerData*> in_car;
-		dispatcher.get_passengers_in_car(in_car);
-		vector<PassengerData*> pickups;
-		vector<PassengerData*> dropoffs;
-		dispatcher.update(pickups, dropoffs);
+		// The in-car list changes during update(), so capture it first.
+		string in_car_str = verbose ? get_passenger_list_str(dispatcher.get_passengers_in_car(), "None") : "";
+		events.clear();
+		dispatcher.update(events);
 		Point car_pos = dispatcher.get_car_pos();
 		if (verbose) {
 			std::cout << "Time step: " << to_string(t) << ", car at: " << car_pos.get_string() << endl;
 
-			std::cout << "Current passengers: " << get_passenger_list_str(in_car, "None") << endl;
-			if (pickups.size() > 0) {
-				std::cout << "Pickups: " << get_passenger_list_str(pickups, nullptr) << endl;
+			std::cout << "Current passengers: " << in_car_str << endl;
+			if (events.get_pickups().size() > 0) {
+				std::cout << "Pickups: " << get_passenger_list_str(events.get_pickups(), nullptr) << endl;
 			}
-			if (dropoffs.size() > 0) {
-				std::cout << "Dropoffs: " << get_passenger_list_str(dropoffs, nullptr) << endl;
+			if (events.get_dropoffs().size() > 0) {
+				std::cout << "Dropoffs: " << get_passenger_list_str(events.get_dropoffs(), nullptr) << endl;
 			}
 		}
 
@@ -277,3 +449,2277 @@ void RideShareTester::run_random_test(const char* test_name, int city_size, int
 	dispatcher.get_statistics(&num_trips, &avg_unhappiness, &avg_trip_time);
 	std::cout << "Total trips: " << to_string(num_trips) << ", average unhappiness: " << to_string(avg_unhappiness) << ", average trip time: " << to_string(avg_trip_time) << endl;
 }
+
+void RideShareTester::run_retirement_test(int num_requests, int idle_steps) {
+	cout << endl << "Running test: idle retirement" << endl;
+	cout << "----------------------------" << endl;
+
+	srand(time(nullptr));
+
+	Dispatcher dispatcher(city_grid_);
+	dispatcher.set_idle_retirement(idle_steps);
+	int requests_made = 0;
+	int peak_roster_size = 0;
+	PassengerHandle first_handle;
+	while (!dispatcher.is_done()) {
+		// One new passenger per step keeps a steady trickle of drop-offs becoming eligible for retirement.
+		if (requests_made < num_requests) {
+			PassengerHandle handle = new_request(dispatcher, make_random_request(rand, city_grid_, "Rider" + to_string(requests_made)));
+			if (requests_made == 0) {
+				first_handle = handle;
+			}
+			requests_made++;
+		}
+		else {
+			dispatcher.set_last_request_made();
+		}
+
+		dispatcher.update();
+		if (dispatcher.get_roster_size() > peak_roster_size) {
+			peak_roster_size = dispatcher.get_roster_size();
+		}
+	}
+
+	// Every passenger made exactly one request, so the roster can only stay small if retirement works.
+	bool succeeded = (peak_roster_size < num_requests / 2) && !dispatcher.is_handle_current(first_handle);
+	cout << "Requests: " << to_string(num_requests) << ", idle steps: " << to_string(idle_steps)
+		<< ", peak roster size: " << to_string(peak_roster_size) << endl;
+	cout << "----------------------------" << endl;
+	if (succeeded) {
+		cout << "Test idle retirement succeeded as expected." << endl;
+	}
+	else {
+		cout << "Test idle retirement unexpectedly failed" << endl;
+	}
+}
+
+void RideShareTester::run_allocation_test(int num_requests) {
+	cout << endl << "Running test: zero-allocation steps" << endl;
+	cout << "----------------------------" << endl;
+
+	/// Counts events without storing them, so the sink itself never allocates.
+	class CountingEventSink : public DispatchEventSink {
+	public:
+		CountingEventSink() : num_pickups_(0), num_dropoffs_(0) {}
+		void on_pickup(PassengerData* passenger) override { num_pickups_++; }
+		void on_drop_off(PassengerData* passenger) override { num_dropoffs_++; }
+		int num_pickups_;
+		int num_dropoffs_;
+	};
+
+	srand(time(nullptr));
+
+	Dispatcher dispatcher(city_grid_);
+	CountingEventSink sink;
+
+	// Warm-up: requests arrive, which is allowed to allocate.
+	int requests_made = 0;
+	while (requests_made < num_requests) {
+		new_request(dispatcher, make_random_request(rand, city_grid_, "Rider" + to_string(requests_made)));
+		requests_made++;
+		dispatcher.update(sink);
+	}
+	dispatcher.set_last_request_made();
+
+	// Steady state: every remaining step, including its pickups and drop-offs, must be allocation-free.
+	int num_steps = 0;
+	int num_dropoffs_before = sink.num_dropoffs_;
+	long long allocations_before = AllocationCounter::get_count();
+	while (!dispatcher.is_done()) {
+		dispatcher.update(sink);
+		num_steps++;
+	}
+	long long num_allocations = AllocationCounter::get_count() - allocations_before;
+	int num_dropoffs = sink.num_dropoffs_ - num_dropoffs_before;
+
+	cout << "Steady-state steps: " << to_string(num_steps) << ", drop-offs: " << to_string(num_dropoffs)
+		<< ", heap allocations: " << to_string(num_allocations) << endl;
+	cout << "----------------------------" << endl;
+	if (num_allocations == 0 && num_dropoffs > 0) {
+		cout << "Test zero-allocation steps succeeded as expected." << endl;
+	}
+	else {
+		cout << "Test zero-allocation steps unexpectedly failed" << endl;
+	}
+}
+
+void RideShareTester::run_arena_test(int num_runs, int requests_per_run) {
+	cout << endl << "Running test: simulation arena" << endl;
+	cout << "----------------------------" << endl;
+
+	srand(time(nullptr));
+
+	const char* names[] = { "Andy", "Betsy", "Charlie", "Danielle", "Emilio", "Francis", "George", "Heidi", "Igor", "Jamie" };
+	int num_names = 10;
+
+	SimulationArena arena(1 << 20);
+	long long allocations_after_first_run = 0;
+	for (int run = 0; run < num_runs; run++) {
+		// The first run is a warm-up: anything lazily allocated outside the dispatcher shows up here.
+		long long allocations_before = AllocationCounter::get_count();
+		{
+			Dispatcher dispatcher(city_grid_, arena.get_resource());
+			int requests_left = requests_per_run;
+			while (!dispatcher.is_done()) {
+				if (requests_left > 0) {
+					int n = rand() % num_names;
+					if (!dispatcher.is_passenger_active(names[n])) {
+						new_request(dispatcher, make_random_request(rand, city_grid_, names[n]));
+						requests_left--;
+					}
+				}
+				else {
+					dispatcher.set_last_request_made();
+				}
+				dispatcher.update();
+			}
+		}
+		arena.reset();
+		if (run > 0) {
+			allocations_after_first_run += AllocationCounter::get_count() - allocations_before;
+		}
+	}
+
+	cout << "Runs: " << to_string(num_runs) << ", requests per run: " << to_string(requests_per_run)
+		<< ", heap allocations after the first run: " << to_string(allocations_after_first_run) << endl;
+	cout << "----------------------------" << endl;
+	if (allocations_after_first_run == 0) {
+		cout << "Test simulation arena succeeded as expected." << endl;
+	}
+	else {
+		cout << "Test simulation arena unexpectedly failed" << endl;
+	}
+}
+
+void RideShareTester::run_parallel_city_test(int num_cities) {
+	cout << endl << "Running test: parallel cities" << endl;
+	cout << "----------------------------" << endl;
+
+	const int num_requests = 200;
+	vector<CitySimulationResult> serial_results;
+	for (int i = 0; i < num_cities; i++) {
+		serial_results.push_back(simulate_city(5 + i, 1000 + i, num_requests));
+	}
+
+	vector<CitySimulationResult> parallel_results(num_cities);
+	vector<thread> threads;
+	for (int i = 0; i < num_cities; i++) {
+		threads.push_back(thread([i, &parallel_results]() {
+			parallel_results[i] = simulate_city(5 + i, 1000 + i, num_requests);
+		}));
+	}
+	for (size_t i = 0; i < threads.size(); i++) {
+		threads[i].join();
+	}
+
+	int num_mismatches = 0;
+	for (int i = 0; i < num_cities; i++) {
+		const CitySimulationResult& a = serial_results[i];
+		const CitySimulationResult& b = parallel_results[i];
+		if (a.num_trips != b.num_trips || a.num_steps != b.num_steps || a.avg_unhappiness != b.avg_unhappiness || a.avg_trip_time != b.avg_trip_time) {
+			num_mismatches++;
+		}
+	}
+
+	cout << "Cities: " << to_string(num_cities) << ", mismatches against serial runs: " << to_string(num_mismatches) << endl;
+	cout << "----------------------------" << endl;
+	if (num_mismatches == 0) {
+		cout << "Test parallel cities succeeded as expected." << endl;
+	}
+	else {
+		cout << "Test parallel cities unexpectedly failed" << endl;
+	}
+}
+
+void RideShareTester::run_small_city_board_test(int num_operations) {
+	cout << endl << "Running test: small city board" << endl;
+	cout << "----------------------------" << endl;
+
+	srand(time(nullptr));
+
+	// A non-square city that uses both words of the board.
+	const int width = 11;
+	const int height = 9;
+	const int num_layers = (int)BoardLayer::Count;
+	CityGrid grid(width, height);
+	SmallCityBoard<Dispatcher::kSmallCityMaxCells> board(grid);
+	vector<int> counts(num_layers * width * height, 0);
+
+	int num_errors = 0;
+	for (int op = 0; op < num_operations; op++) {
+		int layer = rand() % num_layers;
+		Point pt(rand() % width, rand() % height);
+		int& count = counts[(layer * height + pt.y()) * width + pt.x()];
+		if (count > 0 && rand() % 2 == 0) {
+			board.remove((BoardLayer)layer, pt);
+			count--;
+		}
+		else {
+			board.add((BoardLayer)layer, pt);
+			count++;
+		}
+
+		// Brute-force answers: a goal is a waiting pickup or an in-car destination.
+		Point from(rand() % width, rand() % height);
+		int query_row = rand() % height;
+		int query_column = rand() % width;
+		bool row_has_goal = false;
+		bool column_has_goal = false;
+		int num_goal_cells = 0;
+		int nearest_dist = -1;
+		for (int y = 0; y < height; y++) {
+			for (int x = 0; x < width; x++) {
+				int pickups = counts[((int)BoardLayer::Pickups * height + y) * width + x];
+				int in_car = counts[((int)BoardLayer::InCarDestinations * height + y) * width + x];
+				bool is_goal = (pickups + in_car) > 0;
+				if (board.has_goal_at(Point(x, y)) != is_goal) {
+					num_errors++;
+				}
+				if (!is_goal) {
+					continue;
+				}
+				num_goal_cells++;
+				row_has_goal = row_has_goal || (y == query_row);
+				column_has_goal = column_has_goal || (x == query_column);
+				int dist = Point::get_dist(from, Point(x, y));
+				if (nearest_dist < 0 || dist < nearest_dist) {
+					nearest_dist = dist;
+				}
+			}
+		}
+		Point nearest;
+		bool found = board.find_nearest_goal(from, &nearest);
+		if (board.any_goal_in_row(query_row) != row_has_goal || board.any_goal_in_column(query_column) != column_has_goal
+			|| board.count_goal_cells() != num_goal_cells || found != (nearest_dist >= 0)
+			|| (found && Point::get_dist(from, nearest) != nearest_dist)) {
+			num_errors++;
+		}
+	}
+
+	// Cities too big for the board, including ones whose cell count overflows int, must be turned away,
+	// and a dispatcher on one must fall back to its general path.
+	const int big_dims[][2] = { { 50000, 50000 }, { CityGrid::kMaxDimension, CityGrid::kMaxDimension }, { 129, 1 }, { 1, 129 }, { 12, 11 } };
+	int num_rejected = 0;
+	for (const int* dims : big_dims) {
+		if (!SmallCityBoard<Dispatcher::kSmallCityMaxCells>::fits(CityGrid(dims[0], dims[1]))) {
+			num_rejected++;
+		}
+	}
+	Dispatcher big_dispatcher(CityGrid(50000, 50000));
+	big_dispatcher.new_request("Rider0", 49999, 3, 2, 49998);
+	big_dispatcher.set_last_request_made();
+	int big_steps = 0;
+	while (!big_dispatcher.is_done() && big_steps < 300000) {
+		big_dispatcher.update();
+		big_steps++;
+	}
+	int big_trips;
+	float big_unhappiness, big_trip_time;
+	big_dispatcher.get_statistics(&big_trips, &big_unhappiness, &big_trip_time);
+	bool big_ok = num_rejected == 5 && big_dispatcher.get_goal_board() == nullptr && big_trips == 1;
+
+	cout << "Operations: " << to_string(num_operations) << ", mismatches: " << to_string(num_errors) << ", large cities rejected: "
+		<< to_string(num_rejected) << ", trips in a 50000x50000 city: " << to_string(big_trips) << endl;
+	cout << "----------------------------" << endl;
+	if (num_errors == 0 && big_ok) {
+		cout << "Test small city board succeeded as expected." << endl;
+	}
+	else {
+		cout << "Test small city board unexpectedly failed" << endl;
+	}
+}
+
+void RideShareTester::run_snapshot_test(int num_requests, int num_readers) {
+	cout << endl << "Running test: dispatcher snapshots" << endl;
+	cout << "----------------------------" << endl;
+
+	SnapshotPublisher publisher;
+	atomic<bool> simulation_done(false);
+	atomic<long long> num_reads(0);
+	atomic<int> num_errors(0);
+
+	// Readers check that time never runs backwards and that each snapshot agrees with itself.
+	vector<thread> readers;
+	for (int i = 0; i < num_readers; i++) {
+		readers.push_back(thread([&]() {
+			int last_time = -1;
+			while (!simulation_done.load()) {
+				ScopedSnapshot snapshot(publisher);
+				int num_in_car = 0;
+				for (int r = 0; r < snapshot->get_num_riders(); r++) {
+					if (snapshot->is_rider_in_car(r)) {
+						num_in_car++;
+					}
+					if (snapshot->get_rider_name(r).substr(0, 5) != "Rider" || snapshot->get_rider_start(r) == snapshot->get_rider_end(r)) {
+						num_errors++;
+					}
+				}
+				if (snapshot->get_time() < last_time || num_in_car != snapshot->get_num_in_car()
+					|| snapshot->has_car_goal() != (snapshot->get_num_riders() > 0)) {
+					num_errors++;
+				}
+				last_time = snapshot->get_time();
+				num_reads++;
+			}
+		}));
+	}
+
+	minstd_rand rng(7);
+	Dispatcher dispatcher(city_grid_);
+	dispatcher.set_snapshot_publisher(&publisher);
+	int requests_made = 0;
+	while (!dispatcher.is_done()) {
+		if (requests_made < num_requests) {
+			new_request(dispatcher, make_random_request(rng, city_grid_, "Rider" + to_string(requests_made)));
+			requests_made++;
+		}
+		else {
+			dispatcher.set_last_request_made();
+		}
+		dispatcher.update();
+	}
+	simulation_done = true;
+	for (size_t i = 0; i < readers.size(); i++) {
+		readers[i].join();
+	}
+	dispatcher.set_snapshot_publisher(nullptr);
+
+	cout << "Reader threads: " << to_string(num_readers) << ", snapshot reads: " << to_string(num_reads.load())
+		<< ", skipped publishes: " << to_string(publisher.get_num_skipped()) << ", inconsistencies: " << to_string(num_errors.load()) << endl;
+	cout << "----------------------------" << endl;
+	if (num_errors == 0 && num_reads > 0) {
+		cout << "Test dispatcher snapshots succeeded as expected." << endl;
+	}
+	else {
+		cout << "Test dispatcher snapshots unexpectedly failed" << endl;
+	}
+}
+
+void RideShareTester::run_request_queue_test(int num_producers, int requests_per_producer) {
+	cout << endl << "Running test: request queue" << endl;
+	cout << "----------------------------" << endl;
+
+	RequestQueue queue(64);
+	atomic<int> num_producers_done(0);
+
+	// The queue is deliberately small, so producers regularly find it full and have to retry.
+	vector<thread> producers;
+	for (int p = 0; p < num_producers; p++) {
+		producers.push_back(thread([&, p]() {
+			minstd_rand rng(p + 1);
+			RideRequest request;
+			for (int i = 0; i <= requests_per_producer; i++) {
+				request = make_random_request(rng, city_grid_, "Producer" + to_string(p) + "Rider" + to_string(i));
+				if (i == requests_per_producer / 2) {
+					// Pickup and drop-off at the same spot: the dispatcher must drop it, not throw.
+					request.set(request.get_name(), request.get_start_x(), request.get_start_y(), request.get_start_x(), request.get_start_y());
+				}
+				while (!queue.push(request)) {
+					this_thread::yield();
+				}
+			}
+			num_producers_done++;
+		}));
+	}
+
+	// Producers refill the queue while it drains, but no step may take more than its capacity.
+	Dispatcher dispatcher(city_grid_);
+	dispatcher.set_request_queue(&queue);
+	long long max_per_step = 0;
+	long long num_drained = 0;
+	while (!dispatcher.is_done()) {
+		if (num_producers_done.load() == num_producers) {
+			dispatcher.set_last_request_made();
+		}
+		dispatcher.update();
+		long long num_accepted;
+		long long num_rejected;
+		dispatcher.get_queue_statistics(&num_accepted, &num_rejected);
+		max_per_step = max(max_per_step, num_accepted + num_rejected - num_drained);
+		num_drained = num_accepted + num_rejected;
+	}
+	for (size_t i = 0; i < producers.size(); i++) {
+		producers[i].join();
+	}
+
+	int num_trips;
+	float avg_unhappiness;
+	float avg_trip_time;
+	dispatcher.get_statistics(&num_trips, &avg_unhappiness, &avg_trip_time);
+	long long num_accepted;
+	long long num_rejected;
+	dispatcher.get_queue_statistics(&num_accepted, &num_rejected);
+
+	cout << "Producers: " << to_string(num_producers) << ", accepted: " << to_string(num_accepted)
+		<< ", rejected: " << to_string(num_rejected) << ", trips: " << to_string(num_trips) << ", most taken in one step: "
+		<< to_string(max_per_step) << " (capacity " << to_string(queue.get_capacity()) << ")" << endl;
+	cout << "----------------------------" << endl;
+	if (num_accepted == (long long)num_producers * requests_per_producer && num_rejected == num_producers
+		&& num_trips == num_accepted && max_per_step <= queue.get_capacity()) {
+		cout << "Test request queue succeeded as expected." << endl;
+	}
+	else {
+		cout << "Test request queue unexpectedly failed" << endl;
+	}
+}
+
+void RideShareTester::run_request_queue_benchmark(int num_producers, int requests_per_producer) {
+	cout << endl << "Running benchmark: request queue, " << to_string(num_producers) << " producers" << endl;
+	cout << "----------------------------" << endl;
+
+	typedef chrono::steady_clock Clock;
+	RequestQueue queue(1024);
+	atomic<int> num_ready(0);
+	atomic<bool> start(false);
+	atomic<long long> num_full(0);
+
+	vector<thread> producers;
+	for (int p = 0; p < num_producers; p++) {
+		producers.push_back(thread([&]() {
+			RideRequest request;
+			request.set("BenchmarkRider", 1, 2, 3, 4);
+			long long full = 0;
+			num_ready++;
+			while (!start.load()) {
+				this_thread::yield();
+			}
+			for (int i = 0; i < requests_per_producer; i++) {
+				while (!queue.push(request)) {
+					full++;
+					this_thread::yield();
+				}
+			}
+			num_full += full;
+		}));
+	}
+	while (num_ready.load() < num_producers) {
+		this_thread::yield();
+	}
+
+	// The consumer drains the way Dispatcher::update() does: whatever is ready, up to the capacity, in one pass.
+	long long total = (long long)num_producers * requests_per_producer;
+	long long num_popped = 0;
+	long long num_drains = 0;
+	LatencyRecorder drain_times;
+	drain_times.reserve((size_t)total);
+	RideRequest request;
+	Clock::time_point start_time = Clock::now();
+	start = true;
+	while (num_popped < total) {
+		Clock::time_point drain_start = Clock::now();
+		long long batch = 0;
+		while (batch < queue.get_capacity() && queue.pop(&request)) {
+			batch++;
+		}
+		if (batch > 0) {
+			drain_times.record(chrono::duration<double, micro>(Clock::now() - drain_start).count());
+			num_popped += batch;
+			num_drains++;
+		}
+	}
+	double seconds = chrono::duration<double>(Clock::now() - start_time).count();
+	for (size_t i = 0; i < producers.size(); i++) {
+		producers[i].join();
+	}
+
+	cout << "Requests: " << to_string(total) << ", throughput: " << to_string((long long)(total / seconds)) << " requests/s"
+		<< ", full-queue retries: " << to_string(num_full.load()) << endl;
+	cout << "Drains: " << to_string(num_drains) << ", mean batch: " << to_string((double)num_popped / num_drains)
+		<< ", drain latency us p50: " << to_string(drain_times.get_percentile(50)) << ", p99: " << to_string(drain_times.get_percentile(99))
+		<< ", max: " << to_string(drain_times.get_max()) << endl;
+	cout << "----------------------------" << endl;
+}
+
+/// @brief Sink that blocks the dispatcher for a set time on chosen steps, to simulate overruns.
+class StallingEventSink : public DispatchEventSink {
+public:
+	StallingEventSink(int short_stall_step, int long_stall_step, chrono::milliseconds short_stall, chrono::milliseconds long_stall) :
+		short_stall_step_(short_stall_step),
+		long_stall_step_(long_stall_step),
+		short_stall_(short_stall),
+		long_stall_(long_stall),
+		step_(0)
+	{
+	}
+	void on_car_moved(const Point& car_pos, int time) override {
+		step_++;
+		if (step_ == short_stall_step_) {
+			this_thread::sleep_for(short_stall_);
+		}
+		else if (step_ == long_stall_step_) {
+			this_thread::sleep_for(long_stall_);
+		}
+	}
+private:
+	int short_stall_step_;
+	int long_stall_step_;
+	chrono::milliseconds short_stall_;
+	chrono::milliseconds long_stall_;
+	int step_;
+};
+
+void RideShareTester::run_tick_scheduler_test(int num_requests, int period_ms) {
+	cout << endl << "Running test: tick scheduler" << endl;
+	cout << "----------------------------" << endl;
+
+	// The same requests feed both runs, all queued before the first tick.
+	RequestQueue offline_queue(num_requests);
+	RequestQueue realtime_queue(num_requests);
+	minstd_rand rng(11);
+	for (int i = 0; i < num_requests; i++) {
+		RideRequest request = make_random_request(rng, city_grid_, "Rider" + to_string(i));
+		offline_queue.push(request);
+		realtime_queue.push(request);
+	}
+
+	Dispatcher offline_dispatcher(city_grid_);
+	offline_dispatcher.set_request_queue(&offline_queue);
+	offline_dispatcher.set_last_request_made();
+	int offline_steps = 0;
+	while (!offline_dispatcher.is_done()) {
+		offline_dispatcher.update();
+		offline_steps++;
+	}
+
+	// A stall of 2.5 periods is caught up; one of 15 periods exceeds the limit of 5 and forces a resync.
+	Dispatcher dispatcher(city_grid_);
+	dispatcher.set_request_queue(&realtime_queue);
+	dispatcher.set_last_request_made();
+	StallingEventSink stalls(20, 60, chrono::milliseconds(period_ms * 5 / 2), chrono::milliseconds(period_ms * 15));
+	TickScheduler scheduler(dispatcher, chrono::milliseconds(period_ms));
+	scheduler.set_max_catch_up_ticks(5);
+	scheduler.set_event_sink(&stalls);
+	scheduler.run();
+	const TickStatistics& stats = scheduler.get_statistics();
+
+	int offline_trips, trips;
+	float offline_unhappiness, unhappiness;
+	float offline_trip_time, trip_time;
+	offline_dispatcher.get_statistics(&offline_trips, &offline_unhappiness, &offline_trip_time);
+	dispatcher.get_statistics(&trips, &unhappiness, &trip_time);
+
+	cout << "Ticks: " << to_string(stats.get_num_ticks()) << ", catch-up ticks: " << to_string(stats.get_num_catch_up_ticks())
+		<< ", resyncs: " << to_string(stats.get_num_resyncs()) << ", skipped periods: " << to_string(stats.get_num_skipped_periods())
+		<< ", SLO violations: " << to_string(stats.get_num_slo_violations()) << endl;
+	cout << "Jitter us p50: " << to_string(stats.get_jitter().get_percentile(50)) << ", p99: " << to_string(stats.get_jitter().get_percentile(99))
+		<< ", work us p50: " << to_string(stats.get_work_time().get_percentile(50)) << ", p99: " << to_string(stats.get_work_time().get_percentile(99)) << endl;
+	cout << "----------------------------" << endl;
+	if (stats.get_num_ticks() == offline_steps && trips == offline_trips && unhappiness == offline_unhappiness
+		&& trip_time == offline_trip_time && stats.get_num_catch_up_ticks() > 0 && stats.get_num_resyncs() > 0
+		&& stats.get_num_slo_violations() >= 2) {
+		cout << "Test tick scheduler succeeded as expected." << endl;
+	}
+	else {
+		cout << "Test tick scheduler unexpectedly failed" << endl;
+	}
+}
+
+void RideShareTester::run_request_server_test(int num_connections, int requests_per_connection) {
+	cout << endl << "Running test: request server" << endl;
+	cout << "----------------------------" << endl;
+	if (!RIDE_SHARE_HAS_UNIX_SOCKETS) {
+		cout << "Unix domain sockets are not supported on this platform; skipping." << endl;
+		return;
+	}
+
+	string socket_path = make_socket_path("test");
+	RequestServer server(city_grid_, socket_path, chrono::milliseconds(1));
+	TickSubscriber subscriber(socket_path);
+	LoadGenerator generator(socket_path, city_grid_, num_connections, requests_per_connection, 8);
+	long long expected = (long long)num_connections * requests_per_connection;
+	string info = "None";
+	bool succeeded = false;
+	try {
+		server.start();
+	}
+	catch (ServerException e) {
+		info = e.get_info();
+	}
+	if (info == "None") {
+		thread server_thread(&RequestServer::run, &server);
+		try {
+			// Wait for the subscription to take effect, so no drop-off goes unseen.
+			subscriber.start();
+			chrono::steady_clock::time_point give_up = chrono::steady_clock::now() + chrono::seconds(30);
+			while (subscriber.get_num_ticks() == 0 && chrono::steady_clock::now() < give_up) {
+				this_thread::sleep_for(chrono::milliseconds(1));
+			}
+			generator.run();
+			while (subscriber.get_num_dropoffs() < generator.get_statistics().get_num_acked() && chrono::steady_clock::now() < give_up) {
+				this_thread::sleep_for(chrono::milliseconds(1));
+			}
+		}
+		catch (ServerException e) {
+			info = e.get_info();
+		}
+		subscriber.stop();
+		server.stop();
+		server_thread.join();
+
+		const LoadStatistics& stats = generator.get_statistics();
+		cout << "Connections: " << to_string(num_connections) << ", acked: " << to_string(stats.get_num_acked())
+			<< ", errors: " << to_string(stats.get_num_errors()) << ", ticks seen: " << to_string(subscriber.get_num_ticks())
+			<< ", drop-offs seen: " << to_string(subscriber.get_num_dropoffs()) << endl;
+		cout << "Latency us p50: " << to_string(stats.get_latency().get_percentile(50))
+			<< ", p99: " << to_string(stats.get_latency().get_percentile(99)) << endl;
+		succeeded = (stats.get_num_acked() == expected && stats.get_num_errors() == 0 && server.get_num_requests() == expected
+			&& subscriber.get_num_pickups() == expected && subscriber.get_num_dropoffs() == expected);
+	}
+	cout << "Info: " << info << endl;
+	cout << "----------------------------" << endl;
+	if (succeeded) {
+		cout << "Test request server succeeded as expected." << endl;
+	}
+	else {
+		cout << "Test request server unexpectedly failed" << endl;
+	}
+}
+
+void RideShareTester::run_request_server_limits_test() {
+	cout << endl << "Running test: request server limits" << endl;
+	cout << "----------------------------" << endl;
+	if (!RIDE_SHARE_HAS_UNIX_SOCKETS) {
+		cout << "Unix domain sockets are not supported on this platform; skipping." << endl;
+		return;
+	}
+
+	// Ticks are slow, so a burst of requests piles up waiting for the next one.
+	string socket_path = make_socket_path("limits");
+	RequestServer server(city_grid_, socket_path, chrono::milliseconds(500));
+	const chrono::milliseconds reply_timeout(10000);
+	string info = "None";
+	int num_bad_rejected = 0;
+	int num_acked = 0;
+	int num_busy = 0;
+	bool long_line_dropped = false;
+	int num_burst = 3 * (int)RequestServer::kMaxPendingRequests;
+	try {
+		server.start();
+		thread server_thread(&RequestServer::run, &server);
+		try {
+			// Coordinates that aren't exactly two integers are answered with an error, not submitted.
+			RequestClient client(socket_path);
+			client.connect();
+			const char* bad_lines[] = {
+				"{\"name\":\"Bad0\",\"start\":[1],\"end\":[2,3]}\n",
+				"{\"name\":\"Bad1\",\"start\":[],\"end\":[2,3]}\n",
+				"{\"name\":\"Bad2\",\"start\":[1,2],\"end\":[2,3,4]}\n",
+				"{\"name\":\"Bad3\",\"start\":[1.5,2],\"end\":[2,3]}\n",
+			};
+			string line;
+			for (const char* bad_line : bad_lines) {
+				if (client.send_text(bad_line) && client.read_line(&line, reply_timeout) && line.rfind("{\"error\":\"Coordinate", 0) == 0) {
+					num_bad_rejected++;
+				}
+			}
+
+			// Past kMaxPendingRequests, requests are turned away at once rather than held.
+			minstd_rand rng(23);
+			string burst;
+			for (int i = 0; i < num_burst; i++) {
+				RideRequest request = make_random_request(rng, city_grid_, "Burst" + to_string(i));
+				burst += "{\"name\":\"" + string(request.get_name()) + "\",\"start\":[" + to_string(request.get_start_x()) + ","
+					+ to_string(request.get_start_y()) + "],\"end\":[" + to_string(request.get_end_x()) + "," + to_string(request.get_end_y()) + "]}\n";
+			}
+			client.send_text(burst);
+			for (int i = 0; i < num_burst && client.read_line(&line, reply_timeout); i++) {
+				if (line.rfind("{\"ack\":", 0) == 0) {
+					num_acked++;
+				}
+				else if (line.rfind("{\"error\":\"Server is busy\"", 0) == 0) {
+					num_busy++;
+				}
+			}
+
+			// A line that never ends gets the client disconnected.
+			RequestClient long_client(socket_path);
+			long_client.connect();
+			long_client.send_text(string(4 * RequestServer::kMaxLineLength, 'x'));
+			long_line_dropped = !long_client.read_line(&line, reply_timeout);
+		}
+		catch (ServerException e) {
+			info = e.get_info();
+		}
+		server.stop();
+		server_thread.join();
+	}
+	catch (ServerException e) {
+		info = e.get_info();
+	}
+
+	cout << "Bad coordinates rejected: " << to_string(num_bad_rejected) << ", burst of " << to_string(num_burst) << ": acked "
+		<< to_string(num_acked) << ", busy " << to_string(num_busy) << ", long line dropped: " << (long_line_dropped ? "yes" : "no") << endl;
+	cout << "Info: " << info << endl;
+	cout << "----------------------------" << endl;
+	if (num_bad_rejected == 4 && num_acked + num_busy == num_burst && num_busy > 0 && long_line_dropped
+		&& server.get_num_requests() == num_acked && server.get_num_errors() == 4 + num_busy) {
+		cout << "Test request server limits succeeded as expected." << endl;
+	}
+	else {
+		cout << "Test request server limits unexpectedly failed" << endl;
+	}
+}
+
+void RideShareTester::run_request_server_benchmark(int num_connections, int requests_per_connection) {
+	cout << endl << "Running benchmark: request server, " << to_string(num_connections) << " connections" << endl;
+	cout << "----------------------------" << endl;
+	if (!RIDE_SHARE_HAS_UNIX_SOCKETS) {
+		cout << "Unix domain sockets are not supported on this platform; skipping." << endl;
+		return;
+	}
+
+	// A large city, so the dispatcher's own work doesn't dominate the measurement.
+	CityGrid grid(1000, 1000);
+	string socket_path = make_socket_path("bench");
+	RequestServer server(grid, socket_path, chrono::milliseconds(1));
+	LoadGenerator generator(socket_path, grid, num_connections, requests_per_connection, 32);
+	try {
+		server.start();
+	}
+	catch (ServerException e) {
+		cout << "Info: " << e.get_info() << endl;
+		return;
+	}
+	thread server_thread(&RequestServer::run, &server);
+	try {
+		generator.run();
+	}
+	catch (ServerException e) {
+		cout << "Info: " << e.get_info() << endl;
+	}
+	server.stop();
+	server_thread.join();
+
+	const LoadStatistics& stats = generator.get_statistics();
+	const LatencyRecorder& latency = stats.get_latency();
+	cout << "Requests: " << to_string(stats.get_num_acked()) << ", throughput: " << to_string((long long)stats.get_requests_per_second())
+		<< " requests/s, ticks: " << to_string(server.get_num_ticks()) << endl;
+	cout << "Latency us p50: " << to_string(latency.get_percentile(50)) << ", p90: " << to_string(latency.get_percentile(90))
+		<< ", p99: " << to_string(latency.get_percentile(99)) << ", max: " << to_string(latency.get_max()) << endl;
+	cout << "----------------------------" << endl;
+}
+
+void RideShareTester::run_tick_event_ring_test(int num_requests, int capacity) {
+	cout << endl << "Running test: tick event ring" << endl;
+	cout << "----------------------------" << endl;
+	if (!RIDE_SHARE_HAS_POSIX_SHM) {
+		cout << "POSIX shared memory is not supported on this platform; skipping." << endl;
+		return;
+	}
+
+	// Short enough for macOS, which limits shared-memory names to 31 characters.
+	string shm_name = "/ride_share_" + to_string((long long)chrono::steady_clock::now().time_since_epoch().count() % 1000000000);
+	try {
+		TickEventRingPublisher publisher(shm_name, capacity);
+		atomic<bool> simulation_done(false);
+		atomic<int> num_errors(0);
+		long long num_read[2] = { 0, 0 };
+		long long num_dropped[2] = { 0, 0 };
+
+		// Reader 0 polls as fast as it can; reader 1 naps between events, so it is lapped regularly.
+		// No retirement, so each passenger's roster ID is its request number, which lets a reader
+		// tell a torn event from a good one. The publisher only joins after kLateStart steps, so every
+		// tick read must come after that.
+		const int kLateStart = 20;
+		unique_ptr<TickEventRingReader> ring_readers[2];
+		for (int r = 0; r < 2; r++) {
+			ring_readers[r].reset(new TickEventRingReader(shm_name));
+		}
+		vector<thread> readers;
+		for (int r = 0; r < 2; r++) {
+			readers.push_back(thread([&, r]() {
+				TickEventRingReader& reader = *ring_readers[r];
+				TickEvent event;
+				int last_tick = 0;
+				for (;;) {
+					bool done = simulation_done.load();
+					if (!reader.read(&event)) {
+						if (done) {
+							break;
+						}
+						this_thread::yield();
+						continue;
+					}
+					num_read[r]++;
+					bool has_passenger = (event.get_type() != TickEventType::CarMoved);
+					if (event.get_tick() < last_tick || event.get_tick() <= kLateStart || !city_grid_.contains(event.get_pos())
+						|| has_passenger != (string(event.get_name()) == "Rider" + to_string(event.get_passenger().id()))) {
+						num_errors++;
+					}
+					last_tick = event.get_tick();
+					if (r == 1 && num_read[r] % 16 == 0) {
+						this_thread::sleep_for(chrono::microseconds(200));
+					}
+				}
+				num_dropped[r] = reader.get_num_dropped();
+			}));
+		}
+
+		/// Shares the dispatcher with the publisher, recording the clock and the drop-offs.
+		class StepLog : public DispatchEventSink {
+		public:
+			StepLog() : last_time_(0), num_dropoffs_(0) {}
+			void on_car_moved(const Point& car_pos, int time) override { last_time_ = time; }
+			void on_drop_off(PassengerData* passenger) override { num_dropoffs_++; }
+			int last_time_;
+			int num_dropoffs_;
+		};
+		StepLog step_log;
+		FanOutEventSink sinks;
+		sinks.add(&publisher);
+		sinks.add(&step_log);
+
+		minstd_rand rng(13);
+		Dispatcher dispatcher(city_grid_);
+		int requests_made = 0;
+		int num_steps = 0;
+		while (!dispatcher.is_done()) {
+			if (requests_made < num_requests) {
+				new_request(dispatcher, make_random_request(rng, city_grid_, "Rider" + to_string(requests_made)));
+				requests_made++;
+			}
+			else {
+				dispatcher.set_last_request_made();
+			}
+			if (num_steps < kLateStart) {
+				dispatcher.update();
+			}
+			else {
+				dispatcher.update(sinks);
+			}
+			num_steps++;
+		}
+		simulation_done = true;
+		for (size_t i = 0; i < readers.size(); i++) {
+			readers[i].join();
+		}
+
+		long long published = publisher.get_num_published();
+		cout << "Published: " << to_string(published) << ", fast reader read/dropped: " << to_string(num_read[0]) << "/" << to_string(num_dropped[0])
+			<< ", slow reader read/dropped: " << to_string(num_read[1]) << "/" << to_string(num_dropped[1])
+			<< ", bad events: " << to_string(num_errors.load()) << ", drop-offs seen by the other sink: " << to_string(step_log.num_dropoffs_) << endl;
+		cout << "----------------------------" << endl;
+		if (num_errors == 0 && num_read[0] + num_dropped[0] == published && num_read[1] + num_dropped[1] == published && num_dropped[1] > 0
+			&& step_log.last_time_ == num_steps && step_log.num_dropoffs_ > 0) {
+			cout << "Test tick event ring succeeded as expected." << endl;
+		}
+		else {
+			cout << "Test tick event ring unexpectedly failed" << endl;
+		}
+	}
+	catch (SharedMemoryException e) {
+		cout << "Info: " << e.get_info() << endl;
+		cout << "----------------------------" << endl;
+		cout << "Test tick event ring unexpectedly failed" << endl;
+	}
+}
+
+void RideShareTester::run_car_state_test(int num_writes, int num_readers) {
+	cout << endl << "Running test: car state seqlock" << endl;
+	cout << "----------------------------" << endl;
+
+	// Stage 1: every stored state i satisfies pos = (i, -i), goal = (2i, i + 7), has_goal = i is odd,
+	// so any mix of two states breaks the pattern.
+	// The readers must overlap the writes to prove anything, so writing starts once every reader is
+	// running, and goes on past num_writes until each has seen kMinStatesSeen states that are neither the
+	// initial one nor the last. On a machine too loaded to get there, it gives up after kMaxWriteRounds
+	// times num_writes and the test fails.
+	const int kMinStatesSeen = 100;
+	const int kMaxWriteRounds = 50;
+	CarStateSeqlock seqlock;
+	seqlock.store(CarState(0, Point(0, 0), false, Point(0, 7)));
+	atomic<int> num_readers_started(0);
+	atomic<bool> writing_done(false);
+	atomic<long long> num_reads(0);
+	atomic<int> num_torn(0);
+	vector<atomic<int>> num_states_seen(num_readers);
+	vector<thread> readers;
+	for (int r = 0; r < num_readers; r++) {
+		readers.push_back(thread([&, r]() {
+			num_readers_started++;
+			int last_time = 0;
+			while (!writing_done.load()) {
+				CarState state = seqlock.load();
+				int i = state.get_time();
+				if (i < last_time || !(state.get_pos() == Point(i, -i)) || !(state.get_goal() == Point(2 * i, i + 7))
+					|| state.has_goal() != ((i & 1) != 0)) {
+					num_torn++;
+				}
+				if (i != last_time) {
+					num_states_seen[r]++;
+				}
+				last_time = i;
+				num_reads++;
+			}
+		}));
+	}
+	while (num_readers_started.load() < num_readers) {
+		this_thread::yield();
+	}
+	auto all_readers_overlapped = [&]() {
+		for (int r = 0; r < num_readers; r++) {
+			if (num_states_seen[r].load() < kMinStatesSeen) {
+				return false;
+			}
+		}
+		return true;
+	};
+	// Counts are checked before the last store, so every state they include lies strictly between
+	// the initial state and the last one.
+	int i = 1;
+	bool overlapped = false;
+	while (i < num_writes || !overlapped) {
+		seqlock.store(CarState(i, Point(i, -i), (i & 1) != 0, Point(2 * i, i + 7)));
+		i++;
+		if (i >= num_writes && i % 1024 == 0) {
+			overlapped = all_readers_overlapped();
+			if (!overlapped) {
+				if (i >= num_writes * kMaxWriteRounds) {
+					break;
+				}
+				this_thread::yield();
+			}
+		}
+	}
+	seqlock.store(CarState(i, Point(i, -i), (i & 1) != 0, Point(2 * i, i + 7)));
+	int num_stores = i;
+	writing_done = true;
+	for (size_t r = 0; r < readers.size(); r++) {
+		readers[r].join();
+	}
+	readers.clear();
+	int min_states_seen = num_states_seen[0].load();
+	for (int r = 1; r < num_readers; r++) {
+		min_states_seen = min(min_states_seen, num_states_seen[r].load());
+	}
+
+	// Stage 2: poll a live dispatcher. The car moves at most one block per step, so between any two
+	// states it can't have gone farther than the steps in between.
+	atomic<bool> simulation_done(false);
+	atomic<int> num_bad_states(0);
+	minstd_rand rng(17);
+	Dispatcher dispatcher(city_grid_);
+	for (int r = 0; r < num_readers; r++) {
+		readers.push_back(thread([&]() {
+			CarState last = dispatcher.get_car_state();
+			while (!simulation_done.load()) {
+				CarState state = dispatcher.get_car_state();
+				if (state.get_time() < last.get_time() || !city_grid_.contains(state.get_pos())
+					|| (state.has_goal() && !city_grid_.contains(state.get_goal()))
+					|| Point::get_dist(last.get_pos(), state.get_pos()) > state.get_time() - last.get_time()) {
+					num_bad_states++;
+				}
+				last = state;
+			}
+		}));
+	}
+	int requests_made = 0;
+	while (!dispatcher.is_done()) {
+		if (requests_made < 500) {
+			new_request(dispatcher, make_random_request(rng, city_grid_, "Rider" + to_string(requests_made)));
+			requests_made++;
+		}
+		else {
+			dispatcher.set_last_request_made();
+		}
+		dispatcher.update();
+	}
+	simulation_done = true;
+	for (size_t i = 0; i < readers.size(); i++) {
+		readers[i].join();
+	}
+	CarState final_state = dispatcher.get_car_state();
+
+	cout << "Writes: " << to_string(num_stores) << ", reads: " << to_string(num_reads.load()) << ", fewest states seen by a reader: "
+		<< to_string(min_states_seen) << ", torn reads: " << to_string(num_torn.load()) << ", bad dispatcher states: " << to_string(num_bad_states.load()) << endl;
+	cout << "----------------------------" << endl;
+	if (num_torn == 0 && num_bad_states == 0 && overlapped && final_state.get_pos() == dispatcher.get_car_pos() && !final_state.has_goal()) {
+		cout << "Test car state seqlock succeeded as expected." << endl;
+	}
+	else {
+		cout << "Test car state seqlock unexpectedly failed" << endl;
+	}
+}
+
+void RideShareTester::run_scenario_scheduler_test(int num_random_scenarios, int num_fed_scenarios, int num_threads) {
+	cout << endl << "Running test: scenario scheduler" << endl;
+	cout << "----------------------------" << endl;
+
+	const int num_requests = 20;
+	const int num_batches = 30;
+	CityGrid fed_grid(8, 8);
+	vector<vector<vector<RideRequest>>> batches;
+	for (int i = 0; i < num_fed_scenarios; i++) {
+		batches.push_back(make_request_batches(fed_grid, 5000 + i, num_batches));
+	}
+
+	// Reference results, one scenario at a time on this thread.
+	vector<CitySimulationResult> expected;
+	for (int i = 0; i < num_random_scenarios; i++) {
+		expected.push_back(simulate_city(5 + i % 16, 3000 + i, num_requests));
+	}
+	for (int i = 0; i < num_fed_scenarios; i++) {
+		FedCityScenario scenario(fed_grid);
+		for (int b = 0; b < num_batches; b++) {
+			scenario.feed(batches[i][b]);
+		}
+		scenario.finish_input();
+		while (scenario.resume() != ScenarioStatus::Done) {
+		}
+		expected.push_back(scenario.get_result());
+	}
+
+	// The same scenarios interleaved on the pool. The fed ones receive a batch at a time from a thread
+	// that waits for each round to be used up, as if reading from a slow source, so they regularly
+	// run out of input and have to wait.
+	ScenarioScheduler scheduler(num_threads);
+	vector<unique_ptr<RandomCityScenario>> random_scenarios;
+	vector<unique_ptr<FedCityScenario>> fed_scenarios;
+	for (int i = 0; i < num_fed_scenarios; i++) {
+		fed_scenarios.push_back(unique_ptr<FedCityScenario>(new FedCityScenario(fed_grid)));
+		scheduler.add(fed_scenarios.back().get());
+	}
+	for (int i = 0; i < num_random_scenarios; i++) {
+		random_scenarios.push_back(unique_ptr<RandomCityScenario>(new RandomCityScenario(5 + i % 16, 3000 + i, num_requests)));
+		scheduler.add(random_scenarios.back().get());
+	}
+	thread feeder([&]() {
+		for (int b = 0; b <= num_batches; b++) {
+			for (int i = 0; i < num_fed_scenarios; i++) {
+				while (!fed_scenarios[i]->is_input_consumed()) {
+					this_thread::sleep_for(chrono::microseconds(100));
+				}
+			}
+			for (int i = 0; i < num_fed_scenarios; i++) {
+				if (b < num_batches) {
+					fed_scenarios[i]->feed(batches[i][b]);
+				}
+				else {
+					fed_scenarios[i]->finish_input();
+				}
+				scheduler.wake(fed_scenarios[i].get());
+			}
+		}
+	});
+	chrono::steady_clock::time_point start_time = chrono::steady_clock::now();
+	scheduler.run();
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start_time).count();
+	feeder.join();
+
+	int num_mismatches = 0;
+	for (int i = 0; i < num_random_scenarios + num_fed_scenarios; i++) {
+		const CitySimulationResult& a = expected[i];
+		const CitySimulationResult& b = (i < num_random_scenarios) ? random_scenarios[i]->get_result()
+			: fed_scenarios[i - num_random_scenarios]->get_result();
+		if (a.num_trips != b.num_trips || a.num_steps != b.num_steps || a.avg_unhappiness != b.avg_unhappiness || a.avg_trip_time != b.avg_trip_time) {
+			num_mismatches++;
+		}
+	}
+
+	cout << "Scenarios: " << to_string(num_random_scenarios + num_fed_scenarios) << " on " << to_string(num_threads) << " threads"
+		<< ", resumes: " << to_string(scheduler.get_num_resumes()) << ", parks: " << to_string(scheduler.get_num_parks())
+		<< ", seconds: " << to_string(seconds) << ", mismatches: " << to_string(num_mismatches) << endl;
+	cout << "----------------------------" << endl;
+	if (num_mismatches == 0 && scheduler.get_num_parks() > 0) {
+		cout << "Test scenario scheduler succeeded as expected." << endl;
+	}
+	else {
+		cout << "Test scenario scheduler unexpectedly failed" << endl;
+	}
+}
+
+/// @brief Makes the request, if any, that city @p city_index receives in one round of run_city_host_test().
+/// @return False if the city gets no request this round.
+static bool make_city_round_request(minstd_rand& rng, const CityGrid& grid, int city_index, int* num_requests, RideRequest* ret_request) {
+	// Every fourth city is busy. With four workers, those all share a home worker, which can only keep
+	// up if the others steal from it.
+	int request_odds = (city_index % 4 == 0) ? 60 : 5;
+	if ((int)(rng() % 100) >= request_odds) {
+		return false;
+	}
+	*ret_request = make_random_request(rng, grid, "Rider" + to_string((*num_requests)++));
+	return true;
+}
+
+void RideShareTester::run_city_host_test(int num_cities, int num_workers, int num_input_rounds) {
+	cout << endl << "Running test: city host" << endl;
+	cout << "----------------------------" << endl;
+
+	vector<CityGrid> grids;
+	for (int c = 0; c < num_cities; c++) {
+		grids.push_back(CityGrid(6 + (c % 5) * 3, 6 + (c % 3) * 4));
+	}
+
+	// Reference results, one city at a time.
+	vector<CitySimulationResult> expected(num_cities);
+	for (int c = 0; c < num_cities; c++) {
+		minstd_rand rng(7000 + c);
+		Dispatcher dispatcher(grids[c]);
+		int num_requests = 0;
+		RideRequest request;
+		expected[c].num_steps = 0;
+		for (int r = 0; r < num_input_rounds; r++) {
+			if (make_city_round_request(rng, grids[c], c, &num_requests, &request)) {
+				dispatcher.new_request(request.get_name(), request.get_start_x(), request.get_start_y(), request.get_end_x(), request.get_end_y());
+			}
+			dispatcher.update();
+			expected[c].num_steps++;
+		}
+		dispatcher.set_last_request_made();
+		while (!dispatcher.is_done()) {
+			dispatcher.update();
+			expected[c].num_steps++;
+		}
+		dispatcher.get_statistics(&expected[c].num_trips, &expected[c].avg_unhappiness, &expected[c].avg_trip_time);
+	}
+
+	CityHost host(num_workers);
+	vector<minstd_rand> rngs;
+	vector<int> num_requests(num_cities, 0);
+	for (int c = 0; c < num_cities; c++) {
+		host.add_city(grids[c], 16);
+		rngs.push_back(minstd_rand(7000 + c));
+	}
+	RideRequest request;
+	for (int r = 0; r < num_input_rounds; r++) {
+		for (int c = 0; c < num_cities; c++) {
+			if (make_city_round_request(rngs[c], grids[c], c, &num_requests[c], &request)) {
+				host.get_request_queue(c).push(request);
+			}
+		}
+		host.run_round();
+	}
+	for (int c = 0; c < num_cities; c++) {
+		host.get_dispatcher(c).set_last_request_made();
+	}
+	while (!host.is_done()) {
+		host.run_round();
+	}
+
+	int num_mismatches = 0;
+	long long total_ticks = 0;
+	for (int c = 0; c < num_cities; c++) {
+		CitySimulationResult result;
+		host.get_dispatcher(c).get_statistics(&result.num_trips, &result.avg_unhappiness, &result.avg_trip_time);
+		result.num_steps = (int)host.get_tick_latency(c).get_count();
+		total_ticks += result.num_steps;
+		const CitySimulationResult& a = expected[c];
+		if (a.num_trips != result.num_trips || a.num_steps != result.num_steps || a.avg_unhappiness != result.avg_unhappiness
+			|| a.avg_trip_time != result.avg_trip_time) {
+			num_mismatches++;
+		}
+	}
+	long long total_tasks = 0;
+	long long total_steals = 0;
+	for (int w = 0; w < num_workers; w++) {
+		long long num_tasks, num_steals;
+		host.get_worker_statistics(w, &num_tasks, &num_steals);
+		cout << "Worker " << to_string(w) << ": tasks " << to_string(num_tasks) << ", steals " << to_string(num_steals) << endl;
+		total_tasks += num_tasks;
+		total_steals += num_steals;
+	}
+	for (int c = 0; c < 2; c++) {
+		const LatencyRecorder& latency = host.get_tick_latency(c);
+		cout << "City " << to_string(c) << (c % 4 == 0 ? " (busy)" : " (quiet)") << ": ticks " << to_string(latency.get_count())
+			<< ", tick us p50: " << to_string(latency.get_percentile(50)) << ", p99: " << to_string(latency.get_percentile(99)) << endl;
+	}
+	cout << "Cities: " << to_string(num_cities) << ", steals: " << to_string(total_steals) << ", mismatches against solo runs: " << to_string(num_mismatches) << endl;
+
+	// A host needs a worker, and a city whose step throws fails alone while the others finish.
+	bool no_workers_rejected = false;
+	try {
+		CityHost empty_host(0);
+	}
+	catch (CityHostException e) {
+		no_workers_rejected = true;
+	}
+	/// Throws from the dispatcher's step once the clock reaches a set time.
+	class ThrowingEventSink : public DispatchEventSink {
+	public:
+		explicit ThrowingEventSink(int throw_time) : throw_time_(throw_time) {}
+		void on_car_moved(const Point& car_pos, int time) override {
+			if (time == throw_time_) {
+				PassengerException ex("Sink failed");
+				throw ex;
+			}
+		}
+	private:
+		int throw_time_;
+	};
+	ThrowingEventSink throwing_sink(5);
+	CityHost failing_host(2);
+	for (int c = 0; c < 3; c++) {
+		failing_host.add_city(grids[c], 16, c == 1 ? &throwing_sink : nullptr);
+		failing_host.get_dispatcher(c).new_request("Rider0", 0, 0, 5, 5);
+		failing_host.get_dispatcher(c).set_last_request_made();
+	}
+	int failing_rounds = 0;
+	while (!failing_host.is_done() && failing_rounds < 1000) {
+		failing_host.run_round();
+		failing_rounds++;
+	}
+	int failing_trips[3];
+	float failing_unhappiness, failing_trip_time;
+	for (int c = 0; c < 3; c++) {
+		failing_host.get_dispatcher(c).get_statistics(&failing_trips[c], &failing_unhappiness, &failing_trip_time);
+	}
+	bool failure_contained = failing_host.is_done() && failing_host.has_failed(1) && failing_host.get_failure_info(1) == "Sink failed"
+		&& !failing_host.has_failed(0) && !failing_host.has_failed(2) && failing_trips[0] == 1 && failing_trips[1] == 0 && failing_trips[2] == 1
+		&& failing_host.get_tick_latency(1).get_count() == 5;
+	cout << "Zero workers rejected: " << (no_workers_rejected ? "yes" : "no") << ", failing city: " << failing_host.get_failure_info(1)
+		<< ", trips in the other cities: " << to_string(failing_trips[0]) << " and " << to_string(failing_trips[2]) << endl;
+	cout << "----------------------------" << endl;
+	if (num_mismatches == 0 && total_tasks == total_ticks && no_workers_rejected && failure_contained) {
+		cout << "Test city host succeeded as expected." << endl;
+	}
+	else {
+		cout << "Test city host unexpectedly failed" << endl;
+	}
+}
+
+/// @brief Sink that records the time of every pickup and drop-off, indexed by roster ID.
+class EventTimeLog : public DispatchEventSink {
+public:
+	EventTimeLog() : time_(0) {}
+	void on_car_moved(const Point& car_pos, int time) override { time_ = time; }
+	void on_pickup(PassengerData* passenger) override { set(pickup_times_, passenger->get_handle().id()); }
+	void on_drop_off(PassengerData* passenger) override { set(dropoff_times_, passenger->get_handle().id()); }
+	const vector<int>& get_pickup_times() const { return pickup_times_; }
+	const vector<int>& get_dropoff_times() const { return dropoff_times_; }
+private:
+	void set(vector<int>& times, int id) {
+		if ((int)times.size() <= id) {
+			times.resize(id + 1, -1);
+		}
+		times[id] = time_;
+	}
+	int time_;
+	vector<int> pickup_times_;
+	vector<int> dropoff_times_;
+};
+
+void RideShareTester::run_eta_test(int num_requests) {
+	cout << endl << "Running test: ETA estimates" << endl;
+	cout << "----------------------------" << endl;
+
+	minstd_rand rng(19);
+	Dispatcher dispatcher(city_grid_);
+	EventTimeLog events;
+	vector<PassengerHandle> handles;
+	vector<int> predicted_pickups(num_requests, -1);
+	vector<int> predicted_dropoffs(num_requests, -1);
+	int num_queries = 0;
+	int num_inconsistent = 0;
+	int num_aboard_queries = 0;
+	int num_stale_pickups = 0;
+	int t = 0;
+
+	while (!dispatcher.is_done()) {
+		if ((int)handles.size() < num_requests && t % 3 == 0) {
+			handles.push_back(new_request(dispatcher, make_random_request(rng, city_grid_, "Rider" + to_string(handles.size()))));
+
+			// Refresh every prediction, twice over; only the first round should need a new plan.
+			for (int round = 0; round < 2; round++) {
+				for (size_t i = 0; i < handles.size(); i++) {
+					int pickup = dispatcher.estimate_pickup(handles[i]);
+					int dropoff = dispatcher.estimate_dropoff(handles[i]);
+					num_queries += 2;
+					if (pickup >= 0) {
+						predicted_pickups[i] = pickup;
+					}
+					if (dropoff >= 0) {
+						predicted_dropoffs[i] = dropoff;
+						if (pickup > dropoff) {
+							num_inconsistent++;
+						}
+					}
+				}
+			}
+		}
+		else if ((int)handles.size() == num_requests) {
+			dispatcher.set_last_request_made();
+		}
+		dispatcher.update(events);
+		t++;
+
+		// Riders picked up since the last plan was built are aboard now and have no pickup left to estimate.
+		for (size_t i = 0; i < handles.size(); i++) {
+			if (i < events.get_pickup_times().size() && events.get_pickup_times()[i] >= 0
+				&& (i >= events.get_dropoff_times().size() || events.get_dropoff_times()[i] < 0)) {
+				num_aboard_queries++;
+				if (dispatcher.estimate_pickup(handles[i]) != -1) {
+					num_stale_pickups++;
+				}
+			}
+		}
+	}
+
+	// Deferred riders have no active ride, so they get no estimate until they are admitted.
+	Dispatcher deferring_dispatcher(city_grid_);
+	AdmissionPolicy policy;
+	policy.set_max_active(1);
+	deferring_dispatcher.set_admission_policy(policy);
+	PassengerHandle first = new_request(deferring_dispatcher, make_random_request(rng, city_grid_, "First"));
+	PassengerHandle deferred;
+	bool deferred_ok = deferring_dispatcher.submit_request("Deferred", 0, 0, city_grid_.get_width() - 1, city_grid_.get_height() - 1, &deferred) == AdmissionOutcome::Deferred
+		&& deferring_dispatcher.estimate_pickup(first) >= 0 && deferring_dispatcher.estimate_pickup(deferred) == -1
+		&& deferring_dispatcher.estimate_dropoff(deferred) == -1;
+	deferring_dispatcher.set_last_request_made();
+	bool deferred_estimated = false;
+	while (!deferring_dispatcher.is_done() && !deferred_estimated) {
+		deferring_dispatcher.update();
+		deferred_estimated = deferring_dispatcher.estimate_pickup(deferred) >= 0;
+	}
+	deferred_ok = deferred_ok && deferred_estimated;
+
+	// Every event happened after the last request before it, so its latest prediction must be exact.
+	// Rosters aren't retired here, so each passenger's roster ID is its request number.
+	int num_wrong = 0;
+	for (int i = 0; i < num_requests; i++) {
+		if (predicted_pickups[i] != events.get_pickup_times()[i] || predicted_dropoffs[i] != events.get_dropoff_times()[i]) {
+			num_wrong++;
+		}
+	}
+
+	cout << "Requests: " << to_string(num_requests) << ", queries: " << to_string(num_queries) << ", plans built: " << to_string(dispatcher.get_num_plans_built())
+		<< ", wrong estimates: " << to_string(num_wrong) << ", inconsistent estimates: " << to_string(num_inconsistent) << endl;
+	cout << "Pickup queries for riders aboard: " << to_string(num_aboard_queries) << ", stale answers: " << to_string(num_stale_pickups)
+		<< ", deferred rider estimated only once admitted: " << (deferred_ok ? "yes" : "no") << endl;
+	cout << "----------------------------" << endl;
+	if (num_wrong == 0 && num_inconsistent == 0 && dispatcher.get_num_plans_built() == num_requests
+		&& num_aboard_queries > 0 && num_stale_pickups == 0 && deferred_ok) {
+		cout << "Test ETA estimates succeeded as expected." << endl;
+	}
+	else {
+		cout << "Test ETA estimates unexpectedly failed" << endl;
+	}
+}
+
+void RideShareTester::run_bulk_eta_test(int num_requests) {
+	cout << endl << "Running test: bulk ETA estimates" << endl;
+	cout << "----------------------------" << endl;
+
+	minstd_rand rng(44);
+	Dispatcher dispatcher(city_grid_);
+	EventTimeLog events;
+	vector<PassengerHandle> handles;
+	vector<Point> starts;
+	vector<Point> ends;
+	vector<int> etas;
+	long long num_planned_checked = 0;
+	long long num_fallback_checked = 0;
+	long long num_wrong = 0;
+	int t = 0;
+
+	while (!dispatcher.is_done()) {
+		if ((int)starts.size() < num_requests && t % 2 == 0) {
+			RideRequest request = make_random_request(rng, city_grid_, "Rider" + to_string(starts.size()));
+			handles.push_back(new_request(dispatcher, request));
+			starts.push_back(Point(request.get_start_x(), request.get_start_y()));
+			ends.push_back(Point(request.get_end_x(), request.get_end_y()));
+		}
+		else if ((int)starts.size() == num_requests) {
+			dispatcher.set_last_request_made();
+		}
+
+		// Every third step, a single estimate builds the plan first, so the bulk query must read from it.
+		// The plan then stays current until a new request, so later steps may read from it too.
+		bool plan_built = (t % 3 == 1 && !handles.empty());
+		if (plan_built) {
+			dispatcher.estimate_dropoff(handles.back());
+		}
+		etas.assign(dispatcher.get_roster_id_limit(), 0);
+		bool from_plan = dispatcher.estimate_all_next_stops(etas.data());
+		if (plan_built && !from_plan) {
+			num_wrong++;
+		}
+		CarState car = dispatcher.get_car_state();
+		Point leg_end = car.has_goal() ? car.get_goal() : car.get_pos();
+		int leg_end_time = car.get_time() + Point::get_dist(car.get_pos(), leg_end);
+		const vector<int>& pickups = events.get_pickup_times();
+		const vector<int>& dropoffs = events.get_dropoff_times();
+		// Rosters aren't retired here, so each passenger's roster ID is its request number.
+		for (size_t i = 0; i < starts.size(); i++) {
+			bool picked_up = i < pickups.size() && pickups[i] >= 0;
+			bool dropped_off = i < dropoffs.size() && dropoffs[i] >= 0;
+			int expected;
+			if (dropped_off) {
+				expected = -1;
+			}
+			else if (from_plan) {
+				// The plan is current, so these answer from it without rebuilding.
+				expected = picked_up ? dispatcher.estimate_dropoff(handles[i]) : dispatcher.estimate_pickup(handles[i]);
+				num_planned_checked++;
+			}
+			else {
+				expected = leg_end_time + Point::get_dist(leg_end, picked_up ? ends[i] : starts[i]);
+				num_fallback_checked++;
+			}
+			if (etas[i] != expected) {
+				num_wrong++;
+			}
+		}
+		dispatcher.update(events);
+		t++;
+	}
+
+	cout << "Requests: " << to_string(num_requests) << ", steps: " << to_string(t) << ", ETAs checked against the plan: "
+		<< to_string(num_planned_checked) << ", against the fallback: " << to_string(num_fallback_checked) << ", wrong: " << to_string(num_wrong) << endl;
+	cout << "----------------------------" << endl;
+	if (num_wrong == 0 && num_planned_checked > 0 && num_fallback_checked > 0) {
+		cout << "Test bulk ETA estimates succeeded as expected." << endl;
+	}
+	else {
+		cout << "Test bulk ETA estimates unexpectedly failed" << endl;
+	}
+}
+
+void RideShareTester::run_bulk_eta_benchmark(int num_riders, int num_calls) {
+	cout << endl << "Running benchmark: bulk ETA estimates, " << to_string(num_riders) << " riders" << endl;
+	cout << "----------------------------" << endl;
+
+	typedef chrono::steady_clock Clock;
+	CityGrid grid(1000, 1000);
+	Dispatcher dispatcher(grid);
+	minstd_rand rng(44);
+	for (int i = 0; i < num_riders; i++) {
+		string name = "Rider" + to_string(i);
+		int start_x = rng() % 1000;
+		dispatcher.new_request(name.c_str(), start_x, rng() % 1000, (start_x + 1 + rng() % 999) % 1000, rng() % 1000);
+	}
+
+	vector<int> etas(dispatcher.get_roster_id_limit());
+	LatencyRecorder call_times;
+	call_times.reserve(num_calls);
+	long long checksum = 0;
+	for (int i = 0; i < num_calls; i++) {
+		Clock::time_point call_start = Clock::now();
+		dispatcher.estimate_all_next_stops(etas.data());
+		call_times.record(chrono::duration<double, micro>(Clock::now() - call_start).count());
+		checksum += etas[i % num_riders];
+	}
+
+	cout << "Calls: " << to_string(num_calls) << ", latency us p50: " << to_string(call_times.get_percentile(50))
+		<< ", p99: " << to_string(call_times.get_percentile(99)) << ", max: " << to_string(call_times.get_max())
+		<< ", checksum: " << to_string(checksum) << endl;
+	cout << "----------------------------" << endl;
+}
+
+/// @brief Sink that remembers who was dropped off, in order.
+class DropOffLog : public DispatchEventSink {
+public:
+	void on_drop_off(PassengerData* passenger) override { names_.push_back(string(passenger->get_name())); }
+	const vector<string>& get_names() const { return names_; }
+private:
+	vector<string> names_;
+};
+
+void RideShareTester::run_admission_test(int num_bursts, int burst_size) {
+	cout << endl << "Running test: admission control" << endl;
+	cout << "----------------------------" << endl;
+
+	typedef chrono::steady_clock Clock;
+	const int kMaxIntake = 3;
+	const int kMaxActive = 12;
+	const int kMaxDeferred = 30;
+	const int kBurstGap = 10;
+	AdmissionPolicy policy;
+	policy.set_max_intake_per_tick(kMaxIntake);
+	policy.set_max_active(kMaxActive);
+	policy.set_max_deferred(kMaxDeferred);
+
+	minstd_rand rng(45);
+	Dispatcher dispatcher(city_grid_);
+	dispatcher.set_admission_policy(policy);
+	// Retire riders as soon as they are dropped off, so a rider who rebooks while others are deferred
+	// would be retired from under the deferred queue if deferral didn't hold them.
+	dispatcher.set_idle_retirement(0);
+	DropOffLog drop_offs;
+	vector<string> deferred_names;
+	size_t num_deferred_admitted = 0;
+	size_t num_rebooked = 0;
+	size_t num_served_before_step = 0;
+	int num_outcomes[3] = { 0, 0, 0 };
+	int num_wrong_outcomes = 0;
+	int num_limit_violations = 0;
+	int num_order_violations = 0;
+	int max_active = 0;
+	int t = 0;
+	LatencyRecorder update_times;
+
+	// Admissions since the start of the latest update(), which opened the current intake window.
+	long long window_start_admitted = 0;
+	auto submit = [&](const string& name) {
+		long long admitted, deferred, rejected;
+		dispatcher.get_admission_statistics(&admitted, &deferred, &rejected);
+		int num_deferred = dispatcher.get_num_deferred();
+		bool has_room = admitted - window_start_admitted < kMaxIntake && admitted - (long long)drop_offs.get_names().size() < kMaxActive;
+		AdmissionOutcome expected = (num_deferred == 0 && has_room) ? AdmissionOutcome::Admitted
+			: (num_deferred < kMaxDeferred ? AdmissionOutcome::Deferred : AdmissionOutcome::Rejected);
+
+		RideRequest request = make_random_request(rng, dispatcher.get_grid(), name);
+		AdmissionOutcome outcome = dispatcher.submit_request(request.get_name(), request.get_start_x(), request.get_start_y(),
+			request.get_end_x(), request.get_end_y());
+		num_outcomes[(int)outcome]++;
+		if (outcome != expected) {
+			num_wrong_outcomes++;
+		}
+		if (outcome == AdmissionOutcome::Deferred) {
+			deferred_names.push_back(name);
+		}
+	};
+
+	while (!dispatcher.is_done()) {
+		if (t % kBurstGap == 0 && t / kBurstGap < num_bursts) {
+			for (int i = 0; i < burst_size; i++) {
+				submit("Burst" + to_string(t / kBurstGap) + "-" + to_string(i));
+			}
+		}
+		// Rebook a few riders straight after their drop-off, before the next step can retire them.
+		if (drop_offs.get_names().size() > num_served_before_step && num_rebooked < 5 && dispatcher.get_num_deferred() > 0) {
+			submit(drop_offs.get_names().back());
+			num_rebooked++;
+		}
+		if (t == 0) {
+			// new_request() turns a rejection into an exception.
+			bool threw = false;
+			try {
+				dispatcher.new_request("Overflow", 0, 0, 1, 1);
+			}
+			catch (PassengerException e) {
+				threw = true;
+			}
+			if (!threw) {
+				num_wrong_outcomes++;
+			}
+			else {
+				num_outcomes[(int)AdmissionOutcome::Rejected]++;
+			}
+		}
+		else if (t / kBurstGap >= num_bursts) {
+			dispatcher.set_last_request_made();
+		}
+
+		long long admitted, deferred, rejected;
+		dispatcher.get_admission_statistics(&admitted, &deferred, &rejected);
+		window_start_admitted = admitted;
+		num_served_before_step = drop_offs.get_names().size();
+		Clock::time_point update_start = Clock::now();
+		dispatcher.update(drop_offs);
+		update_times.record(chrono::duration<double, micro>(Clock::now() - update_start).count());
+		t++;
+
+		// The step's own admissions all come from the deferred queue, in arrival order, within the limits.
+		long long admitted_after;
+		dispatcher.get_admission_statistics(&admitted_after, &deferred, &rejected);
+		int num_active = (int)(admitted_after - drop_offs.get_names().size());
+		max_active = max(max_active, num_active);
+		if (admitted_after - admitted > kMaxIntake || num_active > kMaxActive) {
+			num_limit_violations++;
+		}
+		// Admitted passengers can board this step but not be dropped off, so each newly admitted one is active.
+		size_t next_deferred = num_deferred_admitted + (size_t)(admitted_after - admitted);
+		for (size_t i = num_deferred_admitted; i < next_deferred; i++) {
+			if (!dispatcher.is_passenger_active(deferred_names[i].c_str())) {
+				num_order_violations++;
+			}
+		}
+		if (next_deferred < deferred_names.size() && dispatcher.is_passenger_active(deferred_names[next_deferred].c_str())) {
+			num_order_violations++;
+		}
+		num_deferred_admitted = next_deferred;
+	}
+
+	long long admitted, deferred, rejected;
+	dispatcher.get_admission_statistics(&admitted, &deferred, &rejected);
+	bool counts_match = admitted == num_outcomes[(int)AdmissionOutcome::Admitted] + num_outcomes[(int)AdmissionOutcome::Deferred]
+		&& deferred == num_outcomes[(int)AdmissionOutcome::Deferred] && rejected == num_outcomes[(int)AdmissionOutcome::Rejected]
+		&& (long long)drop_offs.get_names().size() == admitted;
+
+	// Rejected and invalid requests from new names must not grow the roster: nothing would ever retire them.
+	AdmissionPolicy full_policy;
+	full_policy.set_max_active(1);
+	full_policy.set_max_deferred(1);
+	Dispatcher full_dispatcher(city_grid_);
+	full_dispatcher.set_admission_policy(full_policy);
+	full_dispatcher.submit_request("Admitted", 0, 0, 1, 1);
+	full_dispatcher.submit_request("Deferred", 1, 1, 0, 0);
+	int roster_before = full_dispatcher.get_roster_size();
+	int num_turned_away = 0;
+	for (int i = 0; i < num_bursts * burst_size; i++) {
+		if (full_dispatcher.submit_request(("Rejected" + to_string(i)).c_str(), 0, 0, 1, 1) == AdmissionOutcome::Rejected) {
+			num_turned_away++;
+		}
+		try {
+			full_dispatcher.submit_request(("Invalid" + to_string(i)).c_str(), 1, 1, 1, 1);
+		}
+		catch (PassengerException e) {
+			num_turned_away++;
+		}
+	}
+	bool roster_flat = (num_turned_away == 2 * num_bursts * burst_size && full_dispatcher.get_roster_size() == roster_before);
+
+	// Intake and active limits of 0 would defer everything forever, so they are refused; a deferred
+	// queue of 0 just turns away what can't be admitted at once.
+	int num_zero_limits_refused = 0;
+	AdmissionPolicy zero_policy;
+	function<void()> zero_limits[] = {
+		[&]() { zero_policy.set_max_intake_per_tick(0); },
+		[&]() { zero_policy.set_max_active(0); },
+		[&]() { zero_policy.set_max_deferred(0); },
+	};
+	for (function<void()>& set_zero_limit : zero_limits) {
+		try {
+			set_zero_limit();
+		}
+		catch (AdmissionPolicyException e) {
+			cout << "Refused: " << e.get_info() << endl;
+			num_zero_limits_refused++;
+		}
+	}
+	bool zero_limits_ok = (num_zero_limits_refused == 2 && zero_policy.get_max_intake_per_tick() < 0 && zero_policy.get_max_active() < 0
+		&& zero_policy.get_max_deferred() == 0);
+
+	cout << "Requests: " << to_string(num_bursts * burst_size + num_rebooked + 1) << ", admitted: " << to_string(admitted)
+		<< ", deferred: " << to_string(deferred) << ", rejected: " << to_string(rejected) << ", served: " << to_string(drop_offs.get_names().size()) << endl;
+	cout << "Steps: " << to_string(t) << ", max active: " << to_string(max_active) << ", update us p99: " << to_string(update_times.get_percentile(99))
+		<< ", max: " << to_string(update_times.get_max()) << endl;
+	cout << "Wrong outcomes: " << to_string(num_wrong_outcomes) << ", limit violations: " << to_string(num_limit_violations)
+		<< ", order violations: " << to_string(num_order_violations) << endl;
+	cout << "Turned away from a full queue: " << to_string(num_turned_away) << ", roster size before: " << to_string(roster_before)
+		<< ", after: " << to_string(full_dispatcher.get_roster_size()) << endl;
+	cout << "----------------------------" << endl;
+	if (counts_match && num_wrong_outcomes == 0 && num_limit_violations == 0 && num_order_violations == 0 && num_rebooked > 0 && rejected > 0
+		&& roster_flat && zero_limits_ok) {
+		cout << "Test admission control succeeded as expected." << endl;
+	}
+	else {
+		cout << "Test admission control unexpectedly failed" << endl;
+	}
+}
+
+/// @brief Stream buffer that writes a scenario one step at a time, only when the reader asks for more.
+class GeneratedScenarioBuffer : public streambuf {
+public:
+	GeneratedScenarioBuffer(int num_steps, const CityGrid& grid) : num_steps_(num_steps), num_generated_(0), grid_(grid), rng_(46) {}
+
+	/// @brief Returns the full text, generated the same way, for comparison.
+	static string get_text(int num_steps, const CityGrid& grid) {
+		GeneratedScenarioBuffer buffer(num_steps, grid);
+		string text;
+		while (buffer.generate_next()) {
+			text += buffer.chunk_;
+		}
+		return text;
+	}
+
+	int get_num_generated() const { return num_generated_; }
+
+protected:
+	int_type underflow() override {
+		if (!generate_next()) {
+			return traits_type::eof();
+		}
+		setg(&chunk_[0], &chunk_[0], &chunk_[0] + chunk_.size());
+		return traits_type::to_int_type(chunk_[0]);
+	}
+
+private:
+	/// @brief Fills chunk_ with the next step, or the closing bracket. Returns false past the end.
+	bool generate_next() {
+		if (num_generated_ > num_steps_) {
+			return false;
+		}
+		if (num_generated_ == num_steps_) {
+			chunk_ = "\n]\n";
+		}
+		else {
+			chunk_ = num_generated_ == 0 ? "[\n" : ",\n";
+			chunk_ += "{\"requests\": [";
+			if (num_generated_ % 4 == 0) {
+				RideRequest request = make_random_request(rng_, grid_, "Rider" + to_string(num_generated_));
+				chunk_ += "{\"name\": \"" + string(request.get_name()) + "\", \"start\": [" + to_string(request.get_start_x()) + ", "
+					+ to_string(request.get_start_y()) + "], \"end\": [" + to_string(request.get_end_x()) + ", " + to_string(request.get_end_y()) + "]}";
+			}
+			chunk_ += "]}";
+		}
+		num_generated_++;
+		return true;
+	}
+
+	int num_steps_;
+	int num_generated_;
+	CityGrid grid_;
+	minstd_rand rng_;
+	string chunk_;
+};
+
+void RideShareTester::run_scenario_stream_test(int num_steps) {
+	cout << endl << "Running test: scenario stream" << endl;
+	cout << "----------------------------" << endl;
+
+	// Stream the scenario from a buffer that only produces text on demand.
+	GeneratedScenarioBuffer buffer(num_steps, city_grid_);
+	istream input(&buffer);
+	Dispatcher stream_dispatcher(city_grid_);
+	int max_lookahead = 0;
+	ScenarioStreamReader reader(stream_dispatcher, [&]() {
+		// Chunks generated beyond the steps run, counting the opening bracket's chunk as the first step's.
+		max_lookahead = max(max_lookahead, buffer.get_num_generated() - min(reader.get_num_steps_read(), num_steps));
+		stream_dispatcher.update();
+	});
+	reader.run(input);
+
+	// Replay the same text the old way, parsed into a DOM up front.
+	json j = json::parse(GeneratedScenarioBuffer::get_text(num_steps, city_grid_));
+	Dispatcher dom_dispatcher(city_grid_);
+	json::iterator it = j.begin();
+	while (!dom_dispatcher.is_done()) {
+		if (it != j.end()) {
+			json& requests_json = *(it->find("requests"));
+			for (json::iterator request_it = requests_json.begin(); request_it != requests_json.end(); request_it++) {
+				string name;
+				int start_x, start_y, end_x, end_y;
+				process_request_json(*request_it, &name, &start_x, &start_y, &end_x, &end_y);
+				dom_dispatcher.new_request(name.c_str(), start_x, start_y, end_x, end_y);
+			}
+			it++;
+		}
+		else {
+			dom_dispatcher.set_last_request_made();
+		}
+		dom_dispatcher.update();
+	}
+
+	int stream_trips, dom_trips;
+	float stream_unhappiness, dom_unhappiness, stream_trip_time, dom_trip_time;
+	stream_dispatcher.get_statistics(&stream_trips, &stream_unhappiness, &stream_trip_time);
+	dom_dispatcher.get_statistics(&dom_trips, &dom_unhappiness, &dom_trip_time);
+	bool stats_match = stream_trips == dom_trips && stream_unhappiness == dom_unhappiness && stream_trip_time == dom_trip_time;
+
+	// Malformed input: a syntax error, and a step without requests, both arrive as JSONException.
+	const char* bad_inputs[] = { "[{\"requests\": []}, {\"requests\": [}]", "[{\"requests\": []}, {\"riders\": []}]" };
+	int num_reported = 0;
+	for (const char* bad_input : bad_inputs) {
+		istringstream bad_stream(bad_input);
+		Dispatcher dispatcher(city_grid_);
+		ScenarioStreamReader bad_reader(dispatcher, [&]() { dispatcher.update(); });
+		try {
+			bad_reader.run(bad_stream);
+		}
+		catch (JSONException e) {
+			cout << "Reported: " << e.get_info() << endl;
+			num_reported++;
+		}
+	}
+
+	cout << "Steps read: " << to_string(reader.get_num_steps_read()) << ", trips: " << to_string(stream_trips) << " (DOM replay: " << to_string(dom_trips)
+		<< "), max steps generated ahead: " << to_string(max_lookahead) << endl;
+	cout << "----------------------------" << endl;
+	if (reader.get_num_steps_read() == num_steps && stats_match && max_lookahead <= 1 && num_reported == 2) {
+		cout << "Test scenario stream succeeded as expected." << endl;
+	}
+	else {
+		cout << "Test scenario stream unexpectedly failed" << endl;
+	}
+}
+
+/// @brief Writes @p text to a file named @p name in the temporary directory and returns its path.
+static string write_temp_file(const char* name, const string& text) {
+	fs::path path = fs::temp_directory_path() / name;
+	ofstream file(path, ios::binary | ios::trunc);
+	file.write(text.data(), text.size());
+	return path.string();
+}
+
+/// @brief Replays a scenario through ScenarioStreamReader, returning the dispatcher's statistics.
+template <class Source>
+static void replay_scenario(const CityGrid& grid, Source&& run_reader, int* ret_num_trips, float* ret_avg_unhappiness, float* ret_avg_trip_time) {
+	Dispatcher dispatcher(grid);
+	ScenarioStreamReader reader(dispatcher, [&]() { dispatcher.update(); });
+	run_reader(reader);
+	dispatcher.get_statistics(ret_num_trips, ret_avg_unhappiness, ret_avg_trip_time);
+}
+
+void RideShareTester::run_mapped_file_test(int num_steps) {
+	cout << endl << "Running test: mapped file" << endl;
+	cout << "----------------------------" << endl;
+
+	string text = GeneratedScenarioBuffer::get_text(num_steps, city_grid_);
+	string path = write_temp_file("ride_share_mapped_test.json", text);
+	int stream_trips, mapped_trips;
+	float stream_unhappiness, mapped_unhappiness, stream_trip_time, mapped_trip_time;
+	bool contents_match;
+	bool mapped;
+	{
+		MappedFile file(path);
+		mapped = file.is_mapped();
+		contents_match = string(file.get_data(), file.get_size()) == text;
+		replay_scenario(city_grid_, [&](ScenarioStreamReader& reader) { reader.run(file.get_data(), file.get_size()); },
+			&mapped_trips, &mapped_unhappiness, &mapped_trip_time);
+	}
+	istringstream text_stream(text);
+	replay_scenario(city_grid_, [&](ScenarioStreamReader& reader) { reader.run(text_stream); },
+		&stream_trips, &stream_unhappiness, &stream_trip_time);
+	bool stats_match = mapped_trips == stream_trips && mapped_unhappiness == stream_unhappiness && mapped_trip_time == stream_trip_time;
+	fs::remove(path);
+
+	// An empty file maps to no bytes, which the parser reports as invalid JSON.
+	string empty_path = write_temp_file("ride_share_mapped_empty.json", "");
+	bool empty_reported = false;
+	{
+		MappedFile empty_file(empty_path);
+		try {
+			int trips;
+			float unhappiness, trip_time;
+			replay_scenario(city_grid_, [&](ScenarioStreamReader& reader) { reader.run(empty_file.get_data(), empty_file.get_size()); },
+				&trips, &unhappiness, &trip_time);
+		}
+		catch (JSONException e) {
+			empty_reported = empty_file.get_size() == 0;
+		}
+	}
+	fs::remove(empty_path);
+
+	bool missing_reported = false;
+	try {
+		MappedFile missing_file(path);
+	}
+	catch (MappedFileException e) {
+		cout << "Reported: " << e.get_info() << endl;
+		missing_reported = true;
+	}
+
+	cout << "Bytes: " << to_string(text.size()) << ", mapped: " << (mapped ? "yes" : "no") << ", trips: " << to_string(mapped_trips)
+		<< " (stream replay: " << to_string(stream_trips) << ")" << endl;
+	cout << "----------------------------" << endl;
+	if (contents_match && mapped == (RIDE_SHARE_HAS_MMAP != 0) && stats_match && mapped_trips > 0 && empty_reported && missing_reported) {
+		cout << "Test mapped file succeeded as expected." << endl;
+	}
+	else {
+		cout << "Test mapped file unexpectedly failed" << endl;
+	}
+}
+
+void RideShareTester::run_scenario_load_benchmark(int num_steps) {
+	cout << endl << "Running benchmark: scenario load, " << to_string(num_steps) << " steps" << endl;
+	cout << "----------------------------" << endl;
+
+	typedef chrono::steady_clock Clock;
+	string path = write_temp_file("ride_share_load_benchmark.json", GeneratedScenarioBuffer::get_text(num_steps, city_grid_));
+	double megabytes = (double)fs::file_size(path) / (1024 * 1024);
+
+	// Parsing alone isolates the input path from the dispatching done by a replay.
+	for (int use_mapping = 0; use_mapping < 2; use_mapping++) {
+		Clock::time_point start = Clock::now();
+		bool valid;
+		if (use_mapping) {
+			MappedFile file(path);
+			valid = json::accept(file.get_data(), file.get_data() + file.get_size());
+		}
+		else {
+			ifstream file(path, ios::binary);
+			valid = json::accept(file);
+		}
+		double seconds = chrono::duration<double>(Clock::now() - start).count();
+		cout << (use_mapping ? "mmap" : "ifstream") << " parse only: " << to_string(seconds) << " s (" << to_string(megabytes / seconds) << " MB/s)"
+			<< (valid ? "" : ", invalid JSON") << endl;
+	}
+
+	// Time to the first step shows startup cost; the total includes dispatching every step.
+	for (int use_mapping = 0; use_mapping < 2; use_mapping++) {
+		Clock::time_point start = Clock::now();
+		double first_step_ms = -1;
+		int trips;
+		float unhappiness, trip_time;
+		auto run = [&](ScenarioStreamReader& reader) {
+			if (use_mapping) {
+				MappedFile file(path);
+				reader.run(file.get_data(), file.get_size());
+			}
+			else {
+				ifstream file(path, ios::binary);
+				reader.run(file);
+			}
+		};
+		Dispatcher dispatcher(city_grid_);
+		ScenarioStreamReader reader(dispatcher, [&]() {
+			if (first_step_ms < 0) {
+				first_step_ms = chrono::duration<double, milli>(Clock::now() - start).count();
+			}
+			dispatcher.update();
+		});
+		run(reader);
+		dispatcher.get_statistics(&trips, &unhappiness, &trip_time);
+		double seconds = chrono::duration<double>(Clock::now() - start).count();
+		cout << (use_mapping ? "mmap" : "ifstream") << ": " << to_string(megabytes) << " MB in " << to_string(seconds) << " s ("
+			<< to_string(megabytes / seconds) << " MB/s), first step after " << to_string(first_step_ms) << " ms, trips: " << to_string(trips) << endl;
+	}
+	fs::remove(path);
+	cout << "----------------------------" << endl;
+}
+
+void RideShareTester::run_ride_trace_test() {
+	cout << endl << "Running test: ride trace" << endl;
+	cout << "----------------------------" << endl;
+
+	// Each converted scenario must replay exactly like its JSON.
+	const char* scenarios[] = { "RideRequestsSimple.json", "RideRequests1.json" };
+	string trace_path = (fs::temp_directory_path() / "ride_share_trace_test.rstrace").string();
+	int num_matching = 0;
+	for (const char* scenario : scenarios) {
+		MappedFile json_file(get_json_path(scenario).string());
+		convert_json_to_ride_trace(json_file.get_data(), json_file.get_size(), trace_path);
+		RideTrace trace(trace_path);
+
+		int json_trips, trace_trips;
+		float json_unhappiness, trace_unhappiness, json_trip_time, trace_trip_time;
+		replay_scenario(city_grid_, [&](ScenarioStreamReader& reader) { reader.run(json_file.get_data(), json_file.get_size()); },
+			&json_trips, &json_unhappiness, &json_trip_time);
+		Dispatcher dispatcher(city_grid_);
+		trace.replay(dispatcher, [&]() { dispatcher.update(); });
+		dispatcher.get_statistics(&trace_trips, &trace_unhappiness, &trace_trip_time);
+
+		bool match = json_trips == trace_trips && json_unhappiness == trace_unhappiness && json_trip_time == trace_trip_time;
+		cout << scenario << ": " << to_string(json_file.get_size()) << " bytes of JSON, " << to_string(trace.get_file_size()) << " bytes of trace, "
+			<< to_string(trace.get_num_steps()) << " steps, " << to_string(trace.get_num_requests()) << " requests, " << to_string(trace.get_num_names())
+			<< " names, trips: " << to_string(trace_trips) << (match ? "" : " (mismatch)") << endl;
+		if (match) {
+			num_matching++;
+		}
+	}
+
+	// Damaged traces are rejected when opened: truncated, wrong magic, and a step column out of order.
+	string original;
+	{
+		MappedFile file(trace_path);
+		original = string(file.get_data(), file.get_size());
+	}
+	string damaged[3] = { original.substr(0, original.size() - 1), original, original };
+	damaged[1][0] ^= 1;
+	uint32_t bad_step = 0xFFFFFFFF;
+	memcpy(&damaged[2][48], &bad_step, sizeof(bad_step));
+	int num_rejected = 0;
+	for (const string& text : damaged) {
+		string path = write_temp_file("ride_share_trace_damaged.rstrace", text);
+		try {
+			RideTrace trace(path);
+		}
+		catch (TraceException e) {
+			cout << "Reported: " << e.get_info() << endl;
+			num_rejected++;
+		}
+		fs::remove(path);
+	}
+	fs::remove(trace_path);
+
+	cout << "----------------------------" << endl;
+	if (num_matching == 2 && num_rejected == 3) {
+		cout << "Test ride trace succeeded as expected." << endl;
+	}
+	else {
+		cout << "Test ride trace unexpectedly failed" << endl;
+	}
+}
+
+void RideShareTester::run_ride_trace_benchmark(int num_steps) {
+	cout << endl << "Running benchmark: ride trace, " << to_string(num_steps) << " steps" << endl;
+	cout << "----------------------------" << endl;
+
+	typedef chrono::steady_clock Clock;
+	string json_path = write_temp_file("ride_share_trace_benchmark.json", GeneratedScenarioBuffer::get_text(num_steps, city_grid_));
+	string trace_path = (fs::temp_directory_path() / "ride_share_trace_benchmark.rstrace").string();
+	MappedFile json_file(json_path);
+
+	Clock::time_point start = Clock::now();
+	convert_json_to_ride_trace(json_file.get_data(), json_file.get_size(), trace_path);
+	double convert_seconds = chrono::duration<double>(Clock::now() - start).count();
+
+	// Reading the input alone: parsing the JSON against scanning every column of the trace.
+	start = Clock::now();
+	bool valid = json::accept(json_file.get_data(), json_file.get_data() + json_file.get_size());
+	double parse_seconds = chrono::duration<double>(Clock::now() - start).count();
+
+	start = Clock::now();
+	RideTrace trace(trace_path);
+	double open_seconds = chrono::duration<double>(Clock::now() - start).count();
+	const int kScanPasses = 20;
+	uint64_t checksum = 0;
+	start = Clock::now();
+	for (int pass = 0; pass < kScanPasses; pass++) {
+		for (int i = 0; i < trace.get_num_requests(); i++) {
+			checksum += trace.get_steps()[i] + trace.get_name_ids()[i] + trace.get_starts()[i] + trace.get_ends()[i];
+		}
+	}
+	double scan_seconds = chrono::duration<double>(Clock::now() - start).count() / kScanPasses;
+	double column_megabytes = (double)trace.get_num_requests() * (2 * sizeof(uint32_t) + 2 * sizeof(uint64_t)) / (1024 * 1024);
+
+	// Whole replays, which include dispatching every step.
+	Dispatcher json_dispatcher(city_grid_);
+	ScenarioStreamReader reader(json_dispatcher, [&]() { json_dispatcher.update(); });
+	start = Clock::now();
+	reader.run(json_file.get_data(), json_file.get_size());
+	double json_replay_seconds = chrono::duration<double>(Clock::now() - start).count();
+	Dispatcher trace_dispatcher(city_grid_);
+	start = Clock::now();
+	trace.replay(trace_dispatcher, [&]() { trace_dispatcher.update(); });
+	double trace_replay_seconds = chrono::duration<double>(Clock::now() - start).count();
+
+	cout << "JSON: " << to_string(json_file.get_size()) << " bytes, trace: " << to_string(trace.get_file_size()) << " bytes, converted in "
+		<< to_string(convert_seconds) << " s" << endl;
+	cout << "JSON parse only: " << to_string(parse_seconds * 1000) << " ms" << (valid ? "" : " (invalid JSON)") << ", trace open and validate: "
+		<< to_string(open_seconds * 1000) << " ms, column scan: " << to_string(scan_seconds * 1000) << " ms ("
+		<< to_string(column_megabytes / 1024 / scan_seconds) << " GB/s), checksum: " << to_string(checksum) << endl;
+	cout << "Replay with dispatching, JSON: " << to_string(json_replay_seconds) << " s, trace: " << to_string(trace_replay_seconds) << " s" << endl;
+	fs::remove(json_path);
+	fs::remove(trace_path);
+	cout << "----------------------------" << endl;
+}
+
+void RideShareTester::run_scenario_lines_test() {
+	cout << endl << "Running test: scenario lines" << endl;
+	cout << "----------------------------" << endl;
+
+	// The sparse file holds the same requests as RideRequests1.json, without the idle steps.
+	MappedFile json_file(get_json_path("RideRequests1.json").string());
+	MappedFile lines_file(get_json_path("RideRequestsSparse.jsonl").string());
+	int json_trips, lines_trips, stream_trips;
+	float json_unhappiness, lines_unhappiness, stream_unhappiness, json_trip_time, lines_trip_time, stream_trip_time;
+	replay_scenario(city_grid_, [&](ScenarioStreamReader& reader) { reader.run(json_file.get_data(), json_file.get_size()); },
+		&json_trips, &json_unhappiness, &json_trip_time);
+	{
+		Dispatcher dispatcher(city_grid_);
+		ScenarioLinesReader reader(dispatcher, [&]() { dispatcher.update(); });
+		reader.run(lines_file.get_data(), lines_file.get_size());
+		dispatcher.get_statistics(&lines_trips, &lines_unhappiness, &lines_trip_time);
+	}
+	{
+		// The stream path, with CRLF line endings and blank lines, which are skipped.
+		string text;
+		for (size_t i = 0; i < lines_file.get_size(); i++) {
+			char c = lines_file.get_data()[i];
+			text += (c == '\n') ? "\r\n\r\n" : string(1, c);
+		}
+		istringstream input(text);
+		Dispatcher dispatcher(city_grid_);
+		ScenarioLinesReader reader(dispatcher, [&]() { dispatcher.update(); });
+		reader.run(input);
+		dispatcher.get_statistics(&stream_trips, &stream_unhappiness, &stream_trip_time);
+	}
+	bool stats_match = json_trips == lines_trips && json_unhappiness == lines_unhappiness && json_trip_time == lines_trip_time
+		&& stream_trips == lines_trips && stream_unhappiness == lines_unhappiness && stream_trip_time == lines_trip_time;
+
+	// Each bad line is reported with its line number.
+	const char* bad_inputs[] = {
+		"{\"t\": 0, \"name\": \"Betty\", \"start\": [2, 0], \"end\": [0, 4]}\n{\"t\": 1, \"name\": \"Flavius\", \"start\": [7, 5]\n",
+		"{\"t\": 0, \"name\": \"Betty\", \"start\": [2, 0], \"end\": [0, 4]}\n\n{\"name\": \"Flavius\", \"start\": [7, 5], \"end\": [8, 4]}\n",
+		"{\"t\": -2, \"name\": \"Betty\", \"start\": [2, 0], \"end\": [0, 4]}\n",
+		"{\"t\": 1, \"name\": 77, \"start\": [2, 0], \"end\": [0, 4]}\n",
+	};
+	const char* expected_prefixes[] = { "Line 2: ", "Line 3: Time missing", "Line 1: Time is not", "Line 1: Name is not" };
+	int num_reported = 0;
+	for (int i = 0; i < 4; i++) {
+		istringstream input(bad_inputs[i]);
+		Dispatcher dispatcher(city_grid_);
+		ScenarioLinesReader reader(dispatcher, [&]() { dispatcher.update(); });
+		try {
+			reader.run(input);
+		}
+		catch (JSONException e) {
+			cout << "Reported: " << e.get_info() << endl;
+			if (e.get_info().rfind(expected_prefixes[i], 0) == 0) {
+				num_reported++;
+			}
+		}
+	}
+
+	cout << "Bytes: " << to_string(lines_file.get_size()) << " (array file: " << to_string(json_file.get_size()) << "), trips: " << to_string(lines_trips)
+		<< " (array file: " << to_string(json_trips) << ")" << endl;
+	cout << "----------------------------" << endl;
+	if (stats_match && num_reported == 4) {
+		cout << "Test scenario lines succeeded as expected." << endl;
+	}
+	else {
+		cout << "Test scenario lines unexpectedly failed" << endl;
+	}
+}
+
+/// @brief Replays @p path through the scenario cache in @p cache_dir, returning whether the cache was used
+///        and the dispatcher's statistics.
+static bool replay_cached_scenario(const CityGrid& grid, const string& path, const string& cache_dir, int* ret_num_trips, float* ret_avg_unhappiness, float* ret_avg_trip_time) {
+	Dispatcher dispatcher(grid);
+	bool cache_hit = replay_scenario_cached(path, cache_dir, dispatcher, [&]() { dispatcher.update(); });
+	dispatcher.get_statistics(ret_num_trips, ret_avg_unhappiness, ret_avg_trip_time);
+	return cache_hit;
+}
+
+void RideShareTester::run_scenario_cache_test() {
+	cout << endl << "Running test: scenario cache" << endl;
+	cout << "----------------------------" << endl;
+
+	typedef chrono::steady_clock Clock;
+	string json_text, lines_text;
+	int json_trips;
+	float json_unhappiness, json_trip_time;
+	{
+		MappedFile json_file(get_json_path("RideRequests1.json").string());
+		MappedFile lines_file(get_json_path("RideRequestsSparse.jsonl").string());
+		json_text = string(json_file.get_data(), json_file.get_size());
+		lines_text = string(lines_file.get_data(), lines_file.get_size());
+		replay_scenario(city_grid_, [&](ScenarioStreamReader& reader) { reader.run(json_file.get_data(), json_file.get_size()); },
+			&json_trips, &json_unhappiness, &json_trip_time);
+	}
+	string json_path = write_temp_file("ride_share_cache_test.json", json_text);
+	string lines_path = write_temp_file("ride_share_cache_test.jsonl", lines_text);
+	string cache_dir = (fs::temp_directory_path() / "ride_share_cache_test").string();
+	string cache_path = get_scenario_cache_path(json_path, cache_dir);
+	fs::remove_all(cache_dir);
+
+	// Each step: what is done to the scenario or its cache file first, and whether the load should hit.
+	string edited_text = json_text;
+	size_t newline = edited_text.find('\n');
+	edited_text[newline] = ' ';
+	struct CacheStep {
+		const char* description;
+		function<void()> prepare;
+		bool expect_hit;
+	};
+	CacheStep steps[] = {
+		{ "first load", []() {}, false },
+		{ "unchanged", []() {}, true },
+		{ "scenario edited, same size", [&]() { write_temp_file("ride_share_cache_test.json", edited_text); }, false },
+		{ "unchanged", []() {}, true },
+		{ "cache from another format version", [&]() {
+			MappedFile file(cache_path);
+			string text(file.get_data(), file.get_size());
+			uint32_t old_version = 1;
+			memcpy(&text[8], &old_version, sizeof(old_version));
+			fs::remove(cache_path);
+			ofstream(cache_path, ios::binary).write(text.data(), text.size());
+		}, false },
+		{ "cache truncated", [&]() { fs::resize_file(cache_path, 20); }, false },
+		{ "unchanged", []() {}, true },
+	};
+	int num_correct = 0;
+	for (CacheStep& step : steps) {
+		step.prepare();
+		int trips;
+		float unhappiness, trip_time;
+		Clock::time_point start = Clock::now();
+		bool cache_hit = replay_cached_scenario(city_grid_, json_path, cache_dir, &trips, &unhappiness, &trip_time);
+		double seconds = chrono::duration<double>(Clock::now() - start).count();
+		bool correct = cache_hit == step.expect_hit && trips == json_trips && unhappiness == json_unhappiness && trip_time == json_trip_time;
+		cout << step.description << ": " << (cache_hit ? "hit" : "miss") << ", trips: " << to_string(trips) << ", "
+			<< to_string(seconds * 1000) << " ms" << (correct ? "" : " (unexpected)") << endl;
+		if (correct) {
+			num_correct++;
+		}
+	}
+
+	// A JSON-Lines scenario converts to the same trace contents as its array equivalent.
+	int lines_trips;
+	float lines_unhappiness, lines_trip_time;
+	bool lines_hit = replay_cached_scenario(city_grid_, lines_path, cache_dir, &lines_trips, &lines_unhappiness, &lines_trip_time);
+	lines_hit = replay_cached_scenario(city_grid_, lines_path, cache_dir, &lines_trips, &lines_unhappiness, &lines_trip_time) && !lines_hit;
+	bool lines_match = lines_hit && lines_trips == json_trips && lines_unhappiness == json_unhappiness && lines_trip_time == json_trip_time;
+	cout << "JSON Lines: trips: " << to_string(lines_trips) << (lines_match ? "" : " (unexpected)") << endl;
+
+	// More requests than the trace writer buffers at once, so they are spilled to disk and read back.
+	const int kSpilledSteps = 40000;
+	string spilled_text = GeneratedScenarioBuffer::get_text(kSpilledSteps, city_grid_);
+	string spilled_path = write_temp_file("ride_share_cache_test_spilled.json", spilled_text);
+	int spilled_trips;
+	float spilled_unhappiness, spilled_trip_time;
+	replay_scenario(city_grid_, [&](ScenarioStreamReader& reader) { reader.run(spilled_text.data(), spilled_text.size()); },
+		&spilled_trips, &spilled_unhappiness, &spilled_trip_time);
+	bool spilled_match = true;
+	for (int i = 0; i < 2; i++) {
+		int trips;
+		float unhappiness, trip_time;
+		bool cache_hit = replay_cached_scenario(city_grid_, spilled_path, cache_dir, &trips, &unhappiness, &trip_time);
+		spilled_match = spilled_match && cache_hit == (i == 1) && trips == spilled_trips && unhappiness == spilled_unhappiness && trip_time == spilled_trip_time;
+	}
+	cout << "Spilled scenario: trips: " << to_string(spilled_trips) << (spilled_match ? "" : " (unexpected)") << endl;
+
+	// Without a cache file, a malformed scenario is reported from the step it is found in, as a direct
+	// replay would, once the steps before it have run. Neither that nor converting it leaves a cache file.
+	string bad_path = write_temp_file("ride_share_cache_test_bad.json", "[{\"requests\": []}, {\"requests\": []}, {\"requests\": [");
+	string bad_cache_path = get_scenario_cache_path(bad_path, cache_dir);
+	int bad_steps_run = 0;
+	bool bad_rejected = false;
+	try {
+		Dispatcher dispatcher(city_grid_);
+		replay_scenario_cached(bad_path, cache_dir, dispatcher, [&]() { dispatcher.update(); bad_steps_run++; });
+	}
+	catch (JSONException e) {
+		cout << "Reported after " << to_string(bad_steps_run) << " steps: " << e.get_info() << endl;
+		bad_rejected = bad_steps_run == 2;
+	}
+	try {
+		load_scenario_cached(bad_path, cache_dir);
+		bad_rejected = false;
+	}
+	catch (JSONException e) {
+		// Expected; the missing cache file is checked below.
+	}
+	bad_rejected = bad_rejected && !fs::exists(bad_cache_path) && !fs::exists(bad_cache_path + ".tmp");
+
+	// A trace loaded outright matches the one the replays cached.
+	bool loaded_hit = false;
+	unique_ptr<RideTrace> loaded = load_scenario_cached(json_path, cache_dir, &loaded_hit);
+	bool loaded_match = loaded_hit && loaded->get_num_requests() > 0;
+	cout << "Loaded trace: " << (loaded_hit ? "hit" : "miss") << ", requests: " << to_string(loaded->get_num_requests()) << endl;
+	loaded.reset();
+
+	for (const string& path : { json_path, lines_path, spilled_path, bad_path }) {
+		fs::remove(path);
+	}
+	fs::remove_all(cache_dir);
+	cout << "----------------------------" << endl;
+	if (num_correct == (int)(sizeof(steps) / sizeof(steps[0])) && lines_match && spilled_match && bad_rejected && loaded_match) {
+		cout << "Test scenario cache succeeded as expected." << endl;
+	}
+	else {
+		cout << "Test scenario cache unexpectedly failed" << endl;
+	}
+}
+
+void RideShareTester::run_scenario_cache_benchmark(int num_steps) {
+	cout << endl << "Running benchmark: scenario cache, " << to_string(num_steps) << " steps" << endl;
+	cout << "----------------------------" << endl;
+
+	typedef chrono::steady_clock Clock;
+	string json_path = write_temp_file("ride_share_cache_benchmark.json", GeneratedScenarioBuffer::get_text(num_steps, city_grid_));
+	string cache_dir = (fs::temp_directory_path() / "ride_share_cache_benchmark").string();
+	string cache_path = get_scenario_cache_path(json_path, cache_dir);
+	fs::remove_all(cache_dir);
+
+	// Startup only: from a scenario path to a trace ready to replay.
+	bool cold_hit, warm_hit;
+	Clock::time_point start = Clock::now();
+	unique_ptr<RideTrace> cold_trace = load_scenario_cached(json_path, cache_dir, &cold_hit);
+	double cold_seconds = chrono::duration<double>(Clock::now() - start).count();
+	cold_trace.reset();
+	start = Clock::now();
+	unique_ptr<RideTrace> warm_trace = load_scenario_cached(json_path, cache_dir, &warm_hit);
+	double warm_seconds = chrono::duration<double>(Clock::now() - start).count();
+
+	// Of the warm load, the part spent hashing the scenario to check the cache is current.
+	uint64_t hash;
+	double hash_seconds;
+	{
+		MappedFile json_file(json_path);
+		start = Clock::now();
+		hash = hash_trace_source(json_file.get_data(), json_file.get_size());
+		hash_seconds = chrono::duration<double>(Clock::now() - start).count();
+	}
+
+	cout << "Scenario: " << to_string(fs::file_size(json_path)) << " bytes, cache file: " << to_string(fs::file_size(cache_path)) << " bytes" << endl;
+	cout << "Cold load (parse and write cache): " << to_string(cold_seconds * 1000) << " ms" << (cold_hit ? " (unexpected hit)" : "")
+		<< ", warm load: " << to_string(warm_seconds * 1000) << " ms" << (warm_hit ? "" : " (unexpected miss)")
+		<< ", of which hashing: " << to_string(hash_seconds * 1000) << " ms (" << (hash == warm_trace->get_source_hash() ? "matches" : "mismatch") << ")" << endl;
+	warm_trace.reset();
+	fs::remove(json_path);
+	fs::remove_all(cache_dir);
+	cout << "----------------------------" << endl;
+}
@@ -4,40 +4,46 @@
  * @brief Test harness for the ride-share dispatcher.
  */
 #pragma once
+#include <filesystem>
 #include <string>
-#include "nlohmann/json.hpp"
 #include "passenger.h"
 #include "dispatcher.h"
+#include "request_json.h"
 
 using namespace std;
 using namespace ride_share;
-using json = nlohmann::json;
 
-/// @brief Exception thrown when a JSON ride-request file is malformed or semantically invalid.
-class JSONException {
+/// @brief Collects the pickups and drop-offs from one dispatcher step for printing.
+///
+/// Meant to be cleared and reused every step, so its buffers stop growing once they fit the busiest step.
+class StepEventLog : public DispatchEventSink {
 public:
-	JSONException() {
-		info_ = "";
-	}
-	JSONException(const char* info) {
-		info_ = info;
-	}
-	JSONException(const string& info) {
-		info_ = info;
-	}
-	string get_info() { return info_; }
+	void clear();
+	void on_pickup(PassengerData* passenger) override { pickups_.push_back(passenger); }
+	void on_drop_off(PassengerData* passenger) override { dropoffs_.push_back(passenger); }
+	const PassengerList& get_pickups() { return pickups_; }
+	const PassengerList& get_dropoffs() { return dropoffs_; }
 private:
-	string info_;
+	PassengerList pickups_;
+	PassengerList dropoffs_;
 };
 
 /// @brief Generates and runs JSON-based and randomized dispatcher tests.
 class RideShareTester {
 public:
-	RideShareTester();
+	/// @param city_grid City used by the JSON scenarios and the fixed-size tests.
+	RideShareTester(const CityGrid& city_grid);
 
 	/// @brief Runs the full test suite.
 	void run_tests();
 
+	/// @brief Runs the timing benchmarks. These take a while, so they are not part of run_tests().
+	void run_benchmarks();
+
+	/// @brief Replays the JSON scenarios through cache files kept in @p cache_dir, created if need be,
+	///        instead of parsing them every run. Off by default, and off again if @p cache_dir is empty.
+	void set_scenario_cache_dir(const string& cache_dir) { scenario_cache_dir_ = cache_dir; }
+
 private:
 	/// @brief Runs a single JSON-file test.
 	/// @param json_file Filename within the data/ directory.
@@ -47,19 +53,13 @@ private:
 	/// @brief Loads and fully simulates the scenario described in @p filename.
 	void load_and_run_json(const char* filename);
 
-	/// @brief Loads a JSON file from the data/ directory into @p json_obj.
-	void load_json_file(const char* filename, json& json_obj);
-
-	/// @brief Parses a single ride-request JSON object into its component fields.
-	void process_request_json(json& json_obj, string* ret_name, int* start_x, int* start_y, int* end_x, int* end_y);
-
-	/// @brief Parses a JSON coordinate array [x, y] into integer components.
-	void process_coordinate_json(json& json_obj, int* ret_x, int* ret_y);
+	/// @brief Returns the full path of a file in the data/ directory, printing it.
+	filesystem::path get_json_path(const char* filename);
 
 	/// @brief Returns a comma-separated string of passenger names.
 	/// @param the_list List of passengers.
 	/// @param if_empty_str String to return when the list is empty; nullptr means return "".
-	string get_passenger_list_str(vector<PassengerData*>& the_list, const char* if_empty_str);
+	string get_passenger_list_str(const PassengerList& the_list, const char* if_empty_str);
 
 	/// @brief Runs a simulation driven by randomly generated ride requests.
 	/// @param test_name Label printed in output.
@@ -68,4 +68,157 @@ private:
 	/// @param num_requests Total requests to generate before ending the simulation.
 	/// @param verbose If true, prints per-step output.
 	void run_random_test(const char* test_name, int city_size, int request_odds, int num_requests, bool verbose);
+
+	/// @brief Streams requests from ever-new passenger names and checks that idle retirement keeps the roster bounded.
+	/// @param num_requests Total requests to generate; every request uses a name never seen before.
+	/// @param idle_steps Idle period passed to Dispatcher::set_idle_retirement.
+	void run_retirement_test(int num_requests, int idle_steps);
+
+	/// @brief Checks that dispatcher steps perform no heap allocations once requests have stopped arriving.
+	/// @param num_requests Requests submitted during the warm-up phase.
+	void run_allocation_test(int num_requests);
+
+	/// @brief Runs many short random simulations out of one SimulationArena, resetting it between runs,
+	///        and checks that runs after the first never touch the global heap.
+	/// @param num_runs Number of simulations to run.
+	/// @param requests_per_run Requests submitted in each simulation.
+	void run_arena_test(int num_runs, int requests_per_run);
+
+	/// @brief Runs differently sized cities on parallel threads and checks each matches a serial run of the same input.
+	/// @param num_cities Number of cities (and threads).
+	void run_parallel_city_test(int num_cities);
+
+	/// @brief Applies random adds and removes to a SmallCityBoard and checks every query against a brute-force count,
+	///        then checks cities too big for the board, up to the largest allowed, are turned away.
+	/// @param num_operations Number of random board operations.
+	void run_small_city_board_test(int num_operations);
+
+	/// @brief Runs a simulation that publishes snapshots while reader threads continuously check them for consistency.
+	/// @param num_requests Requests submitted by the simulation thread.
+	/// @param num_readers Number of reader threads.
+	void run_snapshot_test(int num_requests, int num_readers);
+
+	/// @brief Has several threads submit requests through a RequestQueue while the dispatcher drains it,
+	///        and checks every request is served exactly once and invalid ones are counted.
+	/// @param num_producers Number of producer threads.
+	/// @param requests_per_producer Valid requests each producer submits; each also submits one invalid request.
+	void run_request_queue_test(int num_producers, int requests_per_producer);
+
+	/// @brief Measures RequestQueue producer throughput and drain latency with @p num_producers pushing at once.
+	/// @param requests_per_producer Requests each producer pushes.
+	void run_request_queue_benchmark(int num_producers, int requests_per_producer);
+
+	/// @brief Runs a scenario under a TickScheduler with two injected stalls, and checks it catches up,
+	///        resyncs, reports the SLO violations, and ends with the same results as an unscheduled run.
+	/// @param num_requests Requests queued before the first tick.
+	/// @param period_ms Tick period in milliseconds.
+	void run_tick_scheduler_test(int num_requests, int period_ms);
+
+	/// @brief Serves the city over a Unix domain socket and drives it with a LoadGenerator and a
+	///        TickSubscriber, checking every request is acknowledged and eventually dropped off.
+	/// @param num_connections Load generator connections.
+	/// @param requests_per_connection Requests sent over each connection.
+	void run_request_server_test(int num_connections, int requests_per_connection);
+
+	/// @brief Checks the server rejects malformed coordinates, turns away requests past its pending limit
+	///        and disconnects a client whose line never ends.
+	void run_request_server_limits_test();
+
+	/// @brief Measures server request throughput and send-to-ack latency under @p num_connections connections.
+	/// @param requests_per_connection Requests sent over each connection.
+	void run_request_server_benchmark(int num_connections, int requests_per_connection);
+
+	/// @brief Publishes a simulation's events into a small shared-memory ring while a fast and a slow
+	///        reader consume it, checking every event arrives intact or is counted as dropped. The
+	///        publisher joins late, beside another sink, and must still stamp the dispatcher's clock.
+	/// @param num_requests Requests submitted by the simulation.
+	/// @param capacity Ring capacity, in events.
+	void run_tick_event_ring_test(int num_requests, int capacity);
+
+	/// @brief Hammers a CarStateSeqlock with writes while reader threads check every state they load is
+	///        one that was stored, then polls a running dispatcher's car state the same way. Fails unless
+	///        every reader saw many states stored while it was reading.
+	/// @param num_writes Direct stores made to the seqlock, at least; more are made until every reader
+	///        has overlapped the writes.
+	/// @param num_readers Number of reader threads.
+	void run_car_state_test(int num_writes, int num_readers);
+
+	/// @brief Interleaves thousands of random scenarios and some input-fed ones on a ScenarioScheduler,
+	///        and checks each ends exactly as it does when run alone.
+	/// @param num_random_scenarios Scenarios that generate their own requests.
+	/// @param num_fed_scenarios Scenarios that wait for batches fed from another thread.
+	/// @param num_threads Scheduler threads.
+	void run_scenario_scheduler_test(int num_random_scenarios, int num_fed_scenarios, int num_threads);
+
+	/// @brief Runs busy and quiet cities of different sizes on a CityHost and checks each city ends exactly
+	///        as it does when run alone, reporting tick latencies and steals. Then checks a host with no
+	///        workers is refused and a city whose step throws fails without stopping the others.
+	/// @param num_cities Number of cities; every fourth one is busy.
+	/// @param num_workers Host worker threads.
+	/// @param num_input_rounds Rounds during which requests arrive.
+	void run_city_host_test(int num_cities, int num_workers, int num_input_rounds);
+
+	/// @brief Queries pickup and drop-off ETAs after every request and checks each event happens exactly
+	///        when last predicted, with one plan built per request however often it is queried.
+	/// @param num_requests Requests submitted, one every few steps.
+	void run_eta_test(int num_requests);
+
+	/// @brief Checks every step's bulk ETAs against estimate_pickup() and estimate_dropoff() while the plan
+	///        is current, and otherwise against a per-rider calculation from the published car state.
+	/// @param num_requests Requests submitted, one every few steps.
+	void run_bulk_eta_test(int num_requests);
+
+	/// @brief Times bulk ETA queries over a large number of waiting riders.
+	/// @param num_riders Active riders in the dispatcher.
+	/// @param num_calls Queries timed.
+	void run_bulk_eta_benchmark(int num_riders, int num_calls);
+
+	/// @brief Floods a dispatcher with request bursts under an admission policy, checking the intake and
+	///        active limits hold, deferred requests are admitted in order, and every accepted ride is served.
+	///        Also checks rejected and invalid requests from new names leave the roster size unchanged, and
+	///        intake and active limits of 0 are refused.
+	/// @param num_bursts Bursts submitted, one every few steps.
+	/// @param burst_size Requests per burst.
+	void run_admission_test(int num_bursts, int burst_size);
+
+	/// @brief Streams a long generated scenario through ScenarioStreamReader, checking each step runs
+	///        before the next has been read and the results match a DOM replay of the same text, then
+	///        checks malformed input is reported as JSONException.
+	/// @param num_steps Steps in the generated scenario.
+	void run_scenario_stream_test(int num_steps);
+
+	/// @brief Maps a generated scenario file and checks the mapping holds the file's bytes and replays like
+	///        the stream path, and that empty and missing files are reported.
+	/// @param num_steps Steps in the generated scenario.
+	void run_mapped_file_test(int num_steps);
+
+	/// @brief Times replaying a large generated scenario file read through ifstream and through MappedFile.
+	/// @param num_steps Steps in the generated scenario.
+	void run_scenario_load_benchmark(int num_steps);
+
+	/// @brief Converts the JSON scenarios to ride traces and checks each replays exactly like its JSON, then
+	///        checks damaged traces are rejected.
+	void run_ride_trace_test();
+
+	/// @brief Times converting, reading and replaying a large generated scenario as JSON and as a ride trace.
+	/// @param num_steps Steps in the generated scenario.
+	void run_ride_trace_benchmark(int num_steps);
+
+	/// @brief Checks the sparse JSON-Lines scenario replays like its array equivalent, from memory and from
+	///        a stream with CRLF and blank lines, and that bad lines are reported by line number.
+	void run_scenario_lines_test();
+
+	/// @brief Checks scenario cache files are used while current and rebuilt after the scenario is edited or
+	///        the cache file is damaged or from another format version, and replay like the scenario itself.
+	///        Also checks a replay without a current cache streams the scenario, reports a malformed one
+	///        from the step it is found in, and leaves no cache file for it.
+	void run_scenario_cache_test();
+
+	/// @brief Times loading a large generated scenario with no cache file and again with a current one.
+	/// @param num_steps Steps in the generated scenario.
+	void run_scenario_cache_benchmark(int num_steps);
+
+	CityGrid city_grid_;
+	/// Where load_and_run_json() keeps scenario cache files; empty to parse the scenarios directly.
+	string scenario_cache_dir_;
 };
@@ -0,0 +1,296 @@
+/**
+ * @file ride_trace.cpp
+ * @author Ryan McMahon (mcmahonryan@hotmail.com)
+ */
+#include <fstream>
+#include <type_traits>
+#include "ride_trace.h"
+#include "scenario_stream.h"
+#include "scenario_lines.h"
+
+namespace ride_share {
+
+	/// "RSTRACE1", identifying the file format.
+	static const uint64_t kTraceMagic = 0x3145434152545352ULL;
+	static const uint32_t kTraceVersion = 2;
+
+	/// Start of a ride trace file. The columns follow, each at the next 8-byte boundary.
+	struct TraceHeader {
+		uint64_t magic_;
+		uint32_t version_;
+		uint32_t num_steps_;
+		uint32_t num_requests_;
+		uint32_t num_names_;
+		/// Bytes of name text, including each name's null.
+		uint32_t name_text_size_;
+		uint32_t reserved_;
+		uint64_t source_size_;
+		uint64_t source_hash_;
+	};
+
+	static_assert(sizeof(TraceHeader) == 48 && is_trivially_copyable<TraceHeader>::value, "TraceHeader must be a 48-byte plain record");
+
+	/// Byte offset of each column, worked out from the header's counts.
+	struct TraceLayout {
+		size_t steps_;
+		size_t name_ids_;
+		size_t starts_;
+		size_t ends_;
+		size_t name_offsets_;
+		size_t name_text_;
+		size_t end_;
+	};
+
+	static size_t align_column(size_t offset) {
+		return (offset + 7) & ~(size_t)7;
+	}
+
+	static TraceLayout get_layout(const TraceHeader& header) {
+		TraceLayout layout;
+		layout.steps_ = sizeof(TraceHeader);
+		layout.name_ids_ = align_column(layout.steps_ + (size_t)header.num_requests_ * sizeof(uint32_t));
+		layout.starts_ = align_column(layout.name_ids_ + (size_t)header.num_requests_ * sizeof(uint32_t));
+		layout.ends_ = layout.starts_ + (size_t)header.num_requests_ * sizeof(uint64_t);
+		layout.name_offsets_ = layout.ends_ + (size_t)header.num_requests_ * sizeof(uint64_t);
+		layout.name_text_ = align_column(layout.name_offsets_ + ((size_t)header.num_names_ + 1) * sizeof(uint32_t));
+		layout.end_ = layout.name_text_ + header.name_text_size_;
+		return layout;
+	}
+
+	/// @brief Throws a TraceException for an invalid trace file.
+	static void throw_invalid_trace(const string& path, const char* reason) {
+		string info = "Invalid ride trace " + path + ": " + reason;
+		TraceException ex(info);
+		throw ex;
+	}
+
+	/// Rows buffered before they are spilled, and read back at a time by write().
+	static const size_t kRowBlockSize = 4096;
+
+	RideTraceWriter::RideTraceWriter() {
+		num_steps_ = 0;
+		num_requests_ = 0;
+		source_size_ = 0;
+		source_hash_ = 0;
+		spill_file_ = nullptr;
+		name_offsets_.push_back(0);
+	}
+
+	RideTraceWriter::~RideTraceWriter() {
+		if (spill_file_) {
+			fclose(spill_file_);
+		}
+	}
+
+	void RideTraceWriter::add_request(const char* name, int start_x, int start_y, int end_x, int end_y) {
+		unordered_map<string, uint32_t>::iterator it = name_table_.find(name);
+		uint32_t name_id;
+		if (it != name_table_.end()) {
+			name_id = it->second;
+		}
+		else {
+			name_id = (uint32_t)name_table_.size();
+			name_table_.emplace(name, name_id);
+			name_text_ += name;
+			name_text_ += '\0';
+			name_offsets_.push_back((uint32_t)name_text_.size());
+		}
+		if (rows_.size() == kRowBlockSize) {
+			spill_rows();
+		}
+		Row row = { num_steps_, name_id, Point(start_x, start_y).pack(), Point(end_x, end_y).pack() };
+		rows_.push_back(row);
+		num_requests_++;
+	}
+
+	void RideTraceWriter::spill_rows() {
+		if (!spill_file_) {
+			spill_file_ = tmpfile();
+			if (!spill_file_) {
+				TraceException ex("Could not create a temporary file for the ride trace's requests");
+				throw ex;
+			}
+		}
+		if (fwrite(rows_.data(), sizeof(Row), rows_.size(), spill_file_) != rows_.size()) {
+			TraceException ex("Could not spill the ride trace's requests to its temporary file");
+			throw ex;
+		}
+		rows_.clear();
+	}
+
+	void RideTraceWriter::read_rows(const function<void(const Row* rows, size_t count)>& visit) {
+		if (!spill_file_) {
+			visit(rows_.data(), rows_.size());
+			return;
+		}
+		spill_rows();
+		rewind(spill_file_);
+		rows_.resize(kRowBlockSize);
+		size_t count;
+		while ((count = fread(rows_.data(), sizeof(Row), rows_.size(), spill_file_)) > 0) {
+			visit(rows_.data(), count);
+		}
+		bool failed = ferror(spill_file_) != 0;
+		// Leave the file ready for more rows, with the buffer empty as after a spill.
+		fseek(spill_file_, 0, SEEK_END);
+		rows_.clear();
+		if (failed) {
+			TraceException ex("Could not read the ride trace's requests back from its temporary file");
+			throw ex;
+		}
+	}
+
+	template <class T>
+	void RideTraceWriter::write_request_column(ostream& file, T Row::* field) {
+		vector<T> values;
+		read_rows([&](const Row* rows, size_t count) {
+			values.resize(count);
+			for (size_t i = 0; i < count; i++) {
+				values[i] = rows[i].*field;
+			}
+			file.write((const char*)values.data(), count * sizeof(T));
+		});
+	}
+
+	void RideTraceWriter::write(const string& path) {
+		TraceHeader header = {};
+		header.magic_ = kTraceMagic;
+		header.version_ = kTraceVersion;
+		header.num_steps_ = num_steps_;
+		header.num_requests_ = num_requests_;
+		header.num_names_ = (uint32_t)name_table_.size();
+		header.name_text_size_ = (uint32_t)name_text_.size();
+		header.source_size_ = source_size_;
+		header.source_hash_ = source_hash_;
+		TraceLayout layout = get_layout(header);
+
+		ofstream file(path, ios::binary | ios::trunc);
+		size_t written = 0;
+		// Pads with zeros up to @p offset, where a column of @p size bytes is about to be written.
+		auto start_column = [&](size_t offset, size_t size) {
+			static const char kPadding[8] = {};
+			file.write(kPadding, offset - written);
+			written = offset + size;
+		};
+		auto write_column = [&](size_t offset, const void* data, size_t size) {
+			start_column(offset, size);
+			file.write((const char*)data, size);
+		};
+		write_column(0, &header, sizeof(header));
+		start_column(layout.steps_, (size_t)num_requests_ * sizeof(uint32_t));
+		write_request_column(file, &Row::step_);
+		start_column(layout.name_ids_, (size_t)num_requests_ * sizeof(uint32_t));
+		write_request_column(file, &Row::name_id_);
+		start_column(layout.starts_, (size_t)num_requests_ * sizeof(uint64_t));
+		write_request_column(file, &Row::start_);
+		start_column(layout.ends_, (size_t)num_requests_ * sizeof(uint64_t));
+		write_request_column(file, &Row::end_);
+		write_column(layout.name_offsets_, name_offsets_.data(), name_offsets_.size() * sizeof(uint32_t));
+		write_column(layout.name_text_, name_text_.data(), name_text_.size());
+		file.close();
+		if (!file) {
+			string info = "Failed to write ride trace " + path;
+			TraceException ex(info);
+			throw ex;
+		}
+	}
+
+	RideTrace::RideTrace(const string& path) :
+		file_(path)
+	{
+		if (file_.get_size() < sizeof(TraceHeader)) {
+			throw_invalid_trace(path, "too short for a header");
+		}
+		const TraceHeader& header = *(const TraceHeader*)file_.get_data();
+		if (header.magic_ != kTraceMagic) {
+			throw_invalid_trace(path, "bad magic");
+		}
+		if (header.version_ != kTraceVersion) {
+			throw_invalid_trace(path, "unsupported version");
+		}
+		TraceLayout layout = get_layout(header);
+		if (layout.end_ != file_.get_size()) {
+			throw_invalid_trace(path, "size does not match its header");
+		}
+
+		const char* base = file_.get_data();
+		num_steps_ = (int)header.num_steps_;
+		num_requests_ = (int)header.num_requests_;
+		num_names_ = (int)header.num_names_;
+		source_size_ = header.source_size_;
+		source_hash_ = header.source_hash_;
+		steps_ = (const uint32_t*)(base + layout.steps_);
+		name_ids_ = (const uint32_t*)(base + layout.name_ids_);
+		starts_ = (const uint64_t*)(base + layout.starts_);
+		ends_ = (const uint64_t*)(base + layout.ends_);
+		name_offsets_ = (const uint32_t*)(base + layout.name_offsets_);
+		name_text_ = base + layout.name_text_;
+
+		// Check everything the accessors and replay() index with, so they never read out of bounds.
+		if (num_steps_ < 0 || num_requests_ < 0 || num_names_ < 0) {
+			throw_invalid_trace(path, "counts out of range");
+		}
+		if (name_offsets_[0] != 0 || name_offsets_[num_names_] != header.name_text_size_) {
+			throw_invalid_trace(path, "name table does not match its text");
+		}
+		for (int i = 0; i < num_names_; i++) {
+			if (name_offsets_[i] >= name_offsets_[i + 1] || name_text_[name_offsets_[i + 1] - 1] != '\0') {
+				throw_invalid_trace(path, "name table is not in order");
+			}
+		}
+		uint32_t previous_step = 0;
+		for (int i = 0; i < num_requests_; i++) {
+			if (steps_[i] < previous_step || steps_[i] >= header.num_steps_ || name_ids_[i] >= header.num_names_) {
+				throw_invalid_trace(path, "request columns out of range");
+			}
+			previous_step = steps_[i];
+		}
+	}
+
+	void RideTrace::replay(Dispatcher& dispatcher, const function<void()>& step) const {
+		int request = 0;
+		for (uint32_t t = 0; t < (uint32_t)num_steps_; t++) {
+			for (; request < num_requests_ && steps_[request] == t; request++) {
+				Point start = Point::unpack(starts_[request]);
+				Point end = Point::unpack(ends_[request]);
+				dispatcher.new_request(get_name(name_ids_[request]), start.x(), start.y(), end.x(), end.y());
+			}
+			step();
+		}
+		dispatcher.set_last_request_made();
+		while (!dispatcher.is_done()) {
+			step();
+		}
+	}
+
+	uint64_t hash_trace_source(const char* data, size_t size) {
+		uint64_t hash = 0xCBF29CE484222325ULL;
+		for (size_t i = 0; i < size; i++) {
+			hash = (hash ^ (uint8_t)data[i]) * 0x100000001B3ULL;
+		}
+		return hash;
+	}
+
+	/// @brief Runs @p reader over the scenario, collecting its requests and steps into a trace at @p trace_path.
+	template <class Reader>
+	static void convert_to_ride_trace(const char* data, size_t size, const string& trace_path) {
+		RideTraceWriter writer;
+		Reader reader([&](const char* name, int start_x, int start_y, int end_x, int end_y) {
+			writer.add_request(name, start_x, start_y, end_x, end_y);
+		}, [&]() {
+			writer.end_step();
+		});
+		reader.run(data, size);
+		writer.set_source(size, hash_trace_source(data, size));
+		writer.write(trace_path);
+	}
+
+	void convert_json_to_ride_trace(const char* data, size_t size, const string& trace_path) {
+		convert_to_ride_trace<ScenarioStreamReader>(data, size, trace_path);
+	}
+
+	void convert_json_lines_to_ride_trace(const char* data, size_t size, const string& trace_path) {
+		convert_to_ride_trace<ScenarioLinesReader>(data, size, trace_path);
+	}
+
+}  // namespace ride_share
@@ -0,0 +1,170 @@
+/**
+ * @file ride_trace.h
+ * @author Ryan McMahon (mcmahonryan@hotmail.com)
+ * @brief Compact binary columnar format for ride-request scenarios.
+ */
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "dispatcher.h"
+#include "mapped_file.h"
+
+namespace ride_share {
+
+	using namespace std;
+
+	/// @brief Exception thrown when a ride trace can't be written, or a file is not a valid ride trace.
+	class TraceException {
+	public:
+		TraceException() {
+			info_ = "";
+		}
+		TraceException(const char* info) {
+			info_ = info;
+		}
+		TraceException(const string& info) {
+			info_ = info;
+		}
+		string get_info() { return info_; }
+	private:
+		string info_;
+	};
+
+	/// @brief Builds a ride trace and writes it to a file.
+	///
+	/// A ride trace stores the requests of a scenario as columns rather than as one JSON object per
+	/// step: the step each request arrives in, the ID of the passenger's name, and the start and end
+	/// points packed with Point::pack(). Each name is stored once, in a table the name IDs index. Steps
+	/// without requests take no space at all; only the total step count is recorded. The file is laid
+	/// out so that a reader can map it and use the columns in place:
+	///
+	///     header                   48 bytes: magic, version, the counts that size the columns, and the
+	///                              size and FNV-1a hash of the scenario file it was converted from
+	///     steps                    uint32[num_requests], nondecreasing
+	///     name IDs                 uint32[num_requests]
+	///     starts                   uint64[num_requests], Point::pack()
+	///     ends                     uint64[num_requests], Point::pack()
+	///     name offsets             uint32[num_names + 1], into the name text
+	///     name text                the names, each followed by a null
+	///
+	/// Columns start on 8-byte boundaries. Values are stored in the writer's byte order; a reader with
+	/// the other byte order sees the wrong magic and rejects the file.
+	///
+	/// Requests are buffered a block at a time and spilled to an anonymous temporary file, and write()
+	/// reads them back one column at a time, so only the name table grows with the scenario.
+	class RideTraceWriter {
+	public:
+		RideTraceWriter();
+		~RideTraceWriter();
+		RideTraceWriter(const RideTraceWriter&) = delete;
+		RideTraceWriter& operator=(const RideTraceWriter&) = delete;
+
+		/// @brief Adds a request arriving in the current step. Throws TraceException if the requests can't
+		///        be spilled to the temporary file.
+		void add_request(const char* name, int start_x, int start_y, int end_x, int end_y);
+
+		/// @brief Ends the current step; requests added after this arrive in the next one.
+		void end_step() { num_steps_++; }
+
+		int get_num_steps() const { return num_steps_; }
+		int get_num_requests() const { return (int)num_requests_; }
+
+		/// @brief Records the size and hash_trace_source() of the file the trace is converted from, so a
+		///        cache can tell whether the trace is still current. Both are 0 if never set.
+		void set_source(uint64_t size, uint64_t hash) { source_size_ = size; source_hash_ = hash; }
+
+		/// @brief Writes the trace to @p path, replacing any existing file. Throws TraceException on failure.
+		void write(const string& path);
+
+	private:
+		/// @brief One request, holding its value for each request column.
+		struct Row {
+			uint32_t step_;
+			uint32_t name_id_;
+			uint64_t start_;
+			uint64_t end_;
+		};
+
+		/// @brief Appends the buffered rows to the spill file, creating it first if need be.
+		void spill_rows();
+
+		/// @brief Calls @p visit on every row added so far, in order, a block at a time.
+		void read_rows(const function<void(const Row* rows, size_t count)>& visit);
+
+		/// @brief Writes the column made of field @p field of every row to @p file.
+		template <class T> void write_request_column(ostream& file, T Row::* field);
+
+		uint32_t num_steps_;
+		uint32_t num_requests_;
+		uint64_t source_size_;
+		uint64_t source_hash_;
+		vector<Row> rows_;
+		FILE* spill_file_;
+		unordered_map<string, uint32_t> name_table_;
+		vector<uint32_t> name_offsets_;
+		string name_text_;
+	};
+
+	/// @brief A ride trace file, mapped read-only, with its columns available in place.
+	class RideTrace {
+	public:
+		/// @brief Maps and validates the trace at @p path. Throws TraceException if it isn't a valid ride
+		///        trace, or MappedFileException if it can't be read at all.
+		explicit RideTrace(const string& path);
+
+		int get_num_steps() const { return num_steps_; }
+		int get_num_requests() const { return num_requests_; }
+		int get_num_names() const { return num_names_; }
+		size_t get_file_size() const { return file_.get_size(); }
+		/// @brief Returns the size and hash of the scenario file the trace was converted from.
+		uint64_t get_source_size() const { return source_size_; }
+		uint64_t get_source_hash() const { return source_hash_; }
+
+		const uint32_t* get_steps() const { return steps_; }
+		const uint32_t* get_name_ids() const { return name_ids_; }
+		const uint64_t* get_starts() const { return starts_; }
+		const uint64_t* get_ends() const { return ends_; }
+
+		/// @brief Returns the null-terminated name with ID @p name_id.
+		const char* get_name(uint32_t name_id) const { return name_text_ + name_offsets_[name_id]; }
+
+		/// @brief Replays the trace into @p dispatcher the way ScenarioStreamReader replays the JSON.
+		///
+		/// Each step's requests are submitted, then @p step runs; after the last step the last request is
+		/// marked made and @p step keeps running until the dispatcher is done.
+		void replay(Dispatcher& dispatcher, const function<void()>& step) const;
+
+	private:
+		MappedFile file_;
+		int num_steps_;
+		int num_requests_;
+		int num_names_;
+		uint64_t source_size_;
+		uint64_t source_hash_;
+		const uint32_t* steps_;
+		const uint32_t* name_ids_;
+		const uint64_t* starts_;
+		const uint64_t* ends_;
+		const uint32_t* name_offsets_;
+		const char* name_text_;
+	};
+
+	/// @brief Returns the 64-bit FNV-1a hash of @p size bytes at @p data.
+	uint64_t hash_trace_source(const char* data, size_t size);
+
+	/// @brief Converts a JSON scenario of @p size bytes at @p data into a ride trace written to @p trace_path.
+	///
+	/// The JSON is checked as it is read, with the same exceptions as a replay, but the rides themselves
+	/// are not validated against a city, so a replay can still throw PassengerException. The trace
+	/// records the source's size and hash.
+	void convert_json_to_ride_trace(const char* data, size_t size, const string& trace_path);
+
+	/// @brief Same as convert_json_to_ride_trace() for a JSON-Lines scenario, as read by ScenarioLinesReader.
+	void convert_json_lines_to_ride_trace(const char* data, size_t size, const string& trace_path);
+
+}  // namespace ride_share
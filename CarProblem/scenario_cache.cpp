@@ -0,0 +1,139 @@
+/**
+ * @file scenario_cache.cpp
+ * @author Ryan McMahon (mcmahonryan@hotmail.com)
+ */
+#include <filesystem>
+#include "scenario_stream.h"
+#include "scenario_lines.h"
+#include "scenario_cache.h"
+
+namespace ride_share {
+
+	string get_scenario_cache_path(const string& scenario_path, const string& cache_dir) {
+		filesystem::path file_name = filesystem::path(scenario_path).filename();
+		return (filesystem::path(cache_dir) / file_name).string() + ".rscache";
+	}
+
+	/// @brief Returns true if the scenario at @p scenario_path is in the JSON Lines format.
+	static bool is_json_lines(const string& scenario_path) {
+		return filesystem::path(scenario_path).extension() == ".jsonl";
+	}
+
+	/// @brief Opens the trace at @p cache_path if it is a valid trace of a source with @p source_size
+	///        bytes and hash @p source_hash, otherwise returns null.
+	static unique_ptr<RideTrace> open_current_trace(const string& cache_path, uint64_t source_size, uint64_t source_hash) {
+		error_code ignored;
+		if (!filesystem::exists(cache_path, ignored)) {
+			return nullptr;
+		}
+		unique_ptr<RideTrace> trace;
+		try {
+			trace.reset(new RideTrace(cache_path));
+		}
+		catch (TraceException e) {
+			return nullptr;
+		}
+		catch (MappedFileException e) {
+			return nullptr;
+		}
+		if (trace->get_source_size() != source_size || trace->get_source_hash() != source_hash) {
+			return nullptr;
+		}
+		return trace;
+	}
+
+	/// @brief Creates @p cache_dir if need be, then calls @p write_trace to write a trace to a temporary
+	///        path and renames it to @p cache_path, replacing any stale cache file in one step.
+	static void write_cache_file(const string& cache_dir, const string& cache_path, const function<void(const string&)>& write_trace) {
+		error_code dir_error;
+		filesystem::create_directories(cache_dir, dir_error);
+		if (dir_error) {
+			string info = "Could not create the scenario cache directory " + cache_dir + ": " + dir_error.message();
+			TraceException ex(info);
+			throw ex;
+		}
+		string temp_path = cache_path + ".tmp";
+		try {
+			write_trace(temp_path);
+		}
+		catch (...) {
+			error_code ignored;
+			filesystem::remove(temp_path, ignored);
+			throw;
+		}
+		error_code rename_error;
+		filesystem::rename(temp_path, cache_path, rename_error);
+		if (rename_error) {
+			error_code ignored;
+			filesystem::remove(temp_path, ignored);
+			string info = "Could not move the new cache file into place at " + cache_path + ": " + rename_error.message();
+			TraceException ex(info);
+			throw ex;
+		}
+	}
+
+	unique_ptr<RideTrace> load_scenario_cached(const string& scenario_path, const string& cache_dir, bool* ret_cache_hit) {
+		MappedFile source(scenario_path);
+		uint64_t source_hash = hash_trace_source(source.get_data(), source.get_size());
+		string cache_path = get_scenario_cache_path(scenario_path, cache_dir);
+
+		unique_ptr<RideTrace> trace = open_current_trace(cache_path, source.get_size(), source_hash);
+		if (ret_cache_hit) {
+			*ret_cache_hit = (trace != nullptr);
+		}
+		if (trace) {
+			return trace;
+		}
+
+		write_cache_file(cache_dir, cache_path, [&](const string& temp_path) {
+			if (is_json_lines(scenario_path)) {
+				convert_json_lines_to_ride_trace(source.get_data(), source.get_size(), temp_path);
+			}
+			else {
+				convert_json_to_ride_trace(source.get_data(), source.get_size(), temp_path);
+			}
+		});
+		trace.reset(new RideTrace(cache_path));
+		return trace;
+	}
+
+	bool replay_scenario_cached(const string& scenario_path, const string& cache_dir, Dispatcher& dispatcher, const function<void()>& step) {
+		MappedFile source(scenario_path);
+		uint64_t source_hash = hash_trace_source(source.get_data(), source.get_size());
+		string cache_path = get_scenario_cache_path(scenario_path, cache_dir);
+
+		unique_ptr<RideTrace> trace = open_current_trace(cache_path, source.get_size(), source_hash);
+		if (trace) {
+			trace->replay(dispatcher, step);
+			return true;
+		}
+
+		// Feed the dispatcher and the writer from the same pass, in the order RideTrace::replay() uses.
+		RideTraceWriter writer;
+		ScenarioStreamReader::RequestCallback on_request = [&](const char* name, int start_x, int start_y, int end_x, int end_y) {
+			writer.add_request(name, start_x, start_y, end_x, end_y);
+			dispatcher.new_request(name, start_x, start_y, end_x, end_y);
+		};
+		function<void()> record_step = [&]() {
+			writer.end_step();
+			step();
+		};
+		if (is_json_lines(scenario_path)) {
+			ScenarioLinesReader reader(on_request, record_step);
+			reader.run(source.get_data(), source.get_size());
+		}
+		else {
+			ScenarioStreamReader reader(on_request, record_step);
+			reader.run(source.get_data(), source.get_size());
+		}
+		dispatcher.set_last_request_made();
+		while (!dispatcher.is_done()) {
+			step();
+		}
+
+		writer.set_source(source.get_size(), source_hash);
+		write_cache_file(cache_dir, cache_path, [&](const string& temp_path) { writer.write(temp_path); });
+		return false;
+	}
+
+}  // namespace ride_share
@@ -0,0 +1,53 @@
+/**
+ * @file scenario_cache.h
+ * @author Ryan McMahon (mcmahonryan@hotmail.com)
+ * @brief Keeps a ride trace of each scenario file in a cache directory so later runs skip parsing it.
+ */
+#pragma once
+#include <functional>
+#include <memory>
+#include <string>
+#include "dispatcher.h"
+#include "ride_trace.h"
+
+namespace ride_share {
+
+	using namespace std;
+
+	/// @brief Returns the path of the cached trace for the scenario at @p scenario_path: the scenario's file
+	///        name with ".rscache" appended, in @p cache_dir.
+	///
+	/// Scenarios with the same file name in different directories share a cache file. That costs a
+	/// rebuild when they alternate, never a wrong replay, since the cache is checked against the scenario.
+	string get_scenario_cache_path(const string& scenario_path, const string& cache_dir);
+
+	/// @brief Loads the scenario at @p scenario_path as a ride trace, from its cache file in @p cache_dir
+	///        when that is current.
+	///
+	/// The cache file is a ride trace that records the size and hash_trace_source() of the scenario it
+	/// was converted from. It is used only if it opens as a valid trace of the current format version and
+	/// its recorded size and hash match the scenario as it is now, so editing, replacing or truncating the
+	/// scenario invalidates it with no timestamps involved, and a cache file from an older build is
+	/// rejected by its version. Otherwise the scenario is converted again, by extension: ".jsonl" files as
+	/// JSON Lines, anything else as a JSON array of steps. The new trace is written under a temporary name
+	/// and renamed into place, so a reader never sees it half written. @p cache_dir is created if need be.
+	///
+	/// @param ret_cache_hit If not null, set to true if the cache file was used, false if it was rebuilt.
+	/// @return The trace, mapped read-only. Conversion throws JSONException for a malformed scenario;
+	///         MappedFileException or TraceException if the scenario can't be read or its cache can't be written.
+	unique_ptr<RideTrace> load_scenario_cached(const string& scenario_path, const string& cache_dir, bool* ret_cache_hit = nullptr);
+
+	/// @brief Replays the scenario at @p scenario_path into @p dispatcher, from its cache file in
+	///        @p cache_dir when that is current, the way RideTrace::replay() does.
+	///
+	/// Without a current cache file, the scenario is replayed straight from the mapped file by
+	/// ScenarioStreamReader or ScenarioLinesReader, as it would be with no cache at all: each step runs as
+	/// soon as it is read, and a malformed scenario throws JSONException from the step it is found in.
+	/// The requests are recorded with RideTraceWriter as they go, which spills them to disk, and the new
+	/// cache file is written only once the whole scenario has been read.
+	///
+	/// @param step Called once per time step, after that step's requests have been submitted.
+	/// @return True if the cache file was used, false if the scenario was parsed and the cache rebuilt.
+	bool replay_scenario_cached(const string& scenario_path, const string& cache_dir, Dispatcher& dispatcher, const function<void()>& step);
+
+}  // namespace ride_share
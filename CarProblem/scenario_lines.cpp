@@ -0,0 +1,125 @@
+/**
+ * @file scenario_lines.cpp
+ * @author Ryan McMahon (mcmahonryan@hotmail.com)
+ */
+#include <cstring>
+#include <string>
+#include "scenario_lines.h"
+
+namespace ride_share {
+
+	ScenarioLinesReader::ScenarioLinesReader(Dispatcher& dispatcher, function<void()> step) :
+		dispatcher_(&dispatcher),
+		on_request_([&dispatcher](const char* name, int start_x, int start_y, int end_x, int end_y) {
+			dispatcher.new_request(name, start_x, start_y, end_x, end_y);
+		}),
+		step_(step)
+	{
+		num_lines_read_ = 0;
+		current_time_ = 0;
+		step_has_requests_ = false;
+	}
+
+	ScenarioLinesReader::ScenarioLinesReader(ScenarioStreamReader::RequestCallback on_request, function<void()> step) :
+		dispatcher_(nullptr),
+		on_request_(on_request),
+		step_(step)
+	{
+		num_lines_read_ = 0;
+		current_time_ = 0;
+		step_has_requests_ = false;
+	}
+
+	void ScenarioLinesReader::run(istream& input) {
+		start_run();
+		string line;
+		while (getline(input, line)) {
+			process_line(line.data(), line.data() + line.size());
+		}
+		finish_run();
+	}
+
+	void ScenarioLinesReader::run(const char* data, size_t size) {
+		start_run();
+		const char* end = data + size;
+		const char* line_start = data;
+		while (line_start < end) {
+			const char* line_end = (const char*)memchr(line_start, '\n', end - line_start);
+			if (!line_end) {
+				line_end = end;
+			}
+			process_line(line_start, line_end);
+			line_start = line_end + 1;
+		}
+		finish_run();
+	}
+
+	void ScenarioLinesReader::start_run() {
+		num_lines_read_ = 0;
+		current_time_ = 0;
+		step_has_requests_ = false;
+	}
+
+	void ScenarioLinesReader::process_line(const char* begin, const char* end) {
+		num_lines_read_++;
+		if (end > begin && end[-1] == '\r') {
+			end--;
+		}
+		const char* first = begin;
+		while (first < end && (*first == ' ' || *first == '\t')) {
+			first++;
+		}
+		if (first == end) {
+			return;
+		}
+
+		json request_json;
+		try {
+			request_json = json::parse(first, end);
+		}
+		catch (const json::parse_error& ex) {
+			throw_line_error(ex.what());
+		}
+		int time;
+		string name;
+		int start_x, start_y, end_x, end_y;
+		try {
+			process_timed_request_json(request_json, &time, &name, &start_x, &start_y, &end_x, &end_y);
+		}
+		catch (JSONException ex) {
+			throw_line_error(ex.get_info());
+		}
+		if (time < current_time_) {
+			throw_line_error("Time " + to_string(time) + " is earlier than the line before");
+		}
+
+		// Finish the steps before this request's, including any idle ones in between.
+		while (current_time_ < time) {
+			step_();
+			current_time_++;
+			step_has_requests_ = false;
+		}
+		on_request_(name.c_str(), start_x, start_y, end_x, end_y);
+		step_has_requests_ = true;
+	}
+
+	void ScenarioLinesReader::throw_line_error(const string& reason) {
+		string info = "Line " + to_string(num_lines_read_) + ": " + reason;
+		JSONException ex(info);
+		throw ex;
+	}
+
+	void ScenarioLinesReader::finish_run() {
+		if (!dispatcher_) {
+			if (step_has_requests_) {
+				step_();
+			}
+			return;
+		}
+		dispatcher_->set_last_request_made();
+		while (!dispatcher_->is_done()) {
+			step_();
+		}
+	}
+
+}  // namespace ride_share
@@ -0,0 +1,77 @@
+/**
+ * @file scenario_lines.h
+ * @author Ryan McMahon (mcmahonryan@hotmail.com)
+ * @brief Replays a sparse JSON-Lines scenario, one timestamped request per line.
+ */
+#pragma once
+#include <functional>
+#include <istream>
+#include "request_json.h"
+#include "dispatcher.h"
+#include "scenario_stream.h"
+
+namespace ride_share {
+
+	/// @brief Feeds a JSON-Lines scenario to a dispatcher, one line at a time.
+	///
+	/// Each line is a single request with the arrival step in a "t" field:
+	///
+	///     {"t": 16, "name": "Hildebrand", "start": [2, 9], "end": [2, 5]}
+	///
+	/// Steps without requests have no line at all, so idle periods cost nothing. Times must not
+	/// decrease from one line to the next; requests sharing a step are submitted in line order. Blank
+	/// lines are skipped. Since every line stands alone, a file can be split at any line break and the
+	/// pieces parsed independently.
+	///
+	/// Replay matches ScenarioStreamReader on the equivalent array file: each step's requests go to
+	/// Dispatcher::new_request() and then the step callback runs, once for every step up to the last
+	/// line's, idle ones included. Lines are validated by process_timed_request_json(); an invalid line,
+	/// a syntax error, or a time earlier than the line before throws JSONException naming the line.
+	class ScenarioLinesReader {
+	public:
+		/// @param dispatcher Dispatcher to feed; must outlive the reader.
+		/// @param step Called once per time step, after that step's requests have been submitted. It should
+		///        advance the dispatcher, normally with update().
+		ScenarioLinesReader(Dispatcher& dispatcher, function<void()> step);
+
+		/// @brief Reads a scenario without a dispatcher, for tools that convert or inspect it.
+		/// @param on_request Called for each request, in file order.
+		/// @param step Called once per time step up to the last line's, after that step's requests.
+		ScenarioLinesReader(ScenarioStreamReader::RequestCallback on_request, function<void()> step);
+
+		/// @brief Reads @p input to the end, then marks the last request made and keeps stepping until
+		///        the dispatcher is done.
+		void run(istream& input);
+
+		/// @brief Same as run(istream&) over @p size bytes in memory, such as a MappedFile.
+		void run(const char* data, size_t size);
+
+		/// @brief Returns the number of lines read so far, blank ones included.
+		int get_num_lines_read() const { return num_lines_read_; }
+
+	private:
+		/// @brief Resets the replay state before a run.
+		void start_run();
+
+		/// @brief Parses the line from @p begin to @p end (excluding the line break) and submits its request.
+		void process_line(const char* begin, const char* end);
+
+		/// @brief Throws a JSONException for the current line.
+		void throw_line_error(const string& reason);
+
+		/// @brief Marks the last request made and steps until the dispatcher is done, or without a
+		///        dispatcher, finishes the last step.
+		void finish_run();
+
+		/// Null when reading without a dispatcher.
+		Dispatcher* dispatcher_;
+		ScenarioStreamReader::RequestCallback on_request_;
+		function<void()> step_;
+		int num_lines_read_;
+		/// The step whose requests are being submitted; every step before it has run.
+		int current_time_;
+		/// True once a request has been submitted in the current step.
+		bool step_has_requests_;
+	};
+
+}  // namespace ride_share
@@ -0,0 +1,94 @@
+/**
+ * @file scenario_scheduler.cpp
+ * @author Ryan McMahon (mcmahonryan@hotmail.com)
+ */
+#include <thread>
+#include "scenario_scheduler.h"
+
+namespace ride_share {
+
+	/// Ticks per turn used until set_ticks_per_turn() is called. Enough to amortize the queue lock,
+	/// few enough that no scenario hogs a thread.
+	static const int kDefaultTicksPerTurn = 16;
+
+	ScenarioScheduler::ScenarioScheduler(int num_threads) :
+		num_threads_(num_threads),
+		ticks_per_turn_(kDefaultTicksPerTurn),
+		num_unfinished_(0),
+		num_resumes_(0),
+		num_parks_(0)
+	{
+	}
+
+	void ScenarioScheduler::add(Scenario* scenario) {
+		lock_guard<mutex> lock(mutex_);
+		scenario->run_state_ = Scenario::RunState::Queued;
+		scenario->wake_pending_ = false;
+		ready_.push_back(scenario);
+		num_unfinished_++;
+		ready_condition_.notify_one();
+	}
+
+	void ScenarioScheduler::wake(Scenario* scenario) {
+		lock_guard<mutex> lock(mutex_);
+		if (scenario->run_state_ == Scenario::RunState::Parked) {
+			scenario->run_state_ = Scenario::RunState::Queued;
+			ready_.push_back(scenario);
+			ready_condition_.notify_one();
+		}
+		else if (scenario->run_state_ == Scenario::RunState::Running) {
+			scenario->wake_pending_ = true;
+		}
+	}
+
+	void ScenarioScheduler::run() {
+		vector<thread> workers;
+		for (int i = 0; i < num_threads_; i++) {
+			workers.push_back(thread(&ScenarioScheduler::run_worker, this));
+		}
+		for (size_t i = 0; i < workers.size(); i++) {
+			workers[i].join();
+		}
+	}
+
+	void ScenarioScheduler::run_worker() {
+		unique_lock<mutex> lock(mutex_);
+		for (;;) {
+			ready_condition_.wait(lock, [this]() { return !ready_.empty() || num_unfinished_ == 0; });
+			if (ready_.empty()) {
+				return;
+			}
+			Scenario* scenario = ready_.front();
+			ready_.pop_front();
+			scenario->run_state_ = Scenario::RunState::Running;
+			lock.unlock();
+
+			ScenarioStatus status = ScenarioStatus::WaitTick;
+			int num_resumes = 0;
+			while (status == ScenarioStatus::WaitTick && num_resumes < ticks_per_turn_) {
+				status = scenario->resume();
+				num_resumes++;
+			}
+
+			lock.lock();
+			num_resumes_ += num_resumes;
+			if (status == ScenarioStatus::Done) {
+				scenario->run_state_ = Scenario::RunState::Done;
+				num_unfinished_--;
+				if (num_unfinished_ == 0) {
+					ready_condition_.notify_all();
+				}
+			}
+			else if (status == ScenarioStatus::WaitInput && !scenario->wake_pending_) {
+				scenario->run_state_ = Scenario::RunState::Parked;
+				num_parks_++;
+			}
+			else {
+				scenario->run_state_ = Scenario::RunState::Queued;
+				scenario->wake_pending_ = false;
+				ready_.push_back(scenario);
+			}
+		}
+	}
+
+}  // namespace ride_share
@@ -0,0 +1,85 @@
+/**
+ * @file scenario_scheduler.h
+ * @author Ryan McMahon (mcmahonryan@hotmail.com)
+ * @brief Runs many resumable simulations interleaved on a few threads.
+ */
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace ride_share {
+
+	using namespace std;
+
+	/// @brief What a Scenario is waiting for when resume() returns.
+	enum class ScenarioStatus {
+		/// Ran one step; resume again whenever there is time.
+		WaitTick,
+		/// Needs input first; resume after ScenarioScheduler::wake() is called for it.
+		WaitInput,
+		/// Finished; never resumed again.
+		Done
+	};
+
+	/// @brief One simulation written as a resumable state machine.
+	///
+	/// This plays the role a coroutine would: resume() picks up where the last call left off, runs until
+	/// it has to wait, and returns what it is waiting for. All of its state lives in the object, so any
+	/// thread can resume it, though never two at once.
+	class Scenario {
+	public:
+		virtual ~Scenario() {}
+
+		/// @brief Runs until the scenario must wait or is done.
+		virtual ScenarioStatus resume() = 0;
+
+	private:
+		friend class ScenarioScheduler;
+		enum class RunState { Queued, Running, Parked, Done };
+		RunState run_state_ = RunState::Queued;
+		/// Set when wake() arrives while the scenario is running, so the wake-up isn't lost.
+		bool wake_pending_ = false;
+	};
+
+	/// @brief Interleaves any number of Scenarios on a fixed pool of threads.
+	///
+	/// Ready scenarios wait in one FIFO queue. A thread takes one, resumes it for up to a few ticks,
+	/// and puts it at the back, so thousands of scenarios all make progress. A scenario waiting for
+	/// input is parked off the queue and costs nothing until wake() brings it back.
+	class ScenarioScheduler {
+	public:
+		/// @param num_threads Number of worker threads run() uses.
+		explicit ScenarioScheduler(int num_threads);
+
+		/// @brief Sets how many consecutive ticks a scenario may run before going to the back of the queue.
+		void set_ticks_per_turn(int ticks) { ticks_per_turn_ = ticks; }
+
+		/// @brief Adds @p scenario, which must stay alive until run() returns. Can be called during run().
+		void add(Scenario* scenario);
+
+		/// @brief Makes a scenario waiting for input runnable again. Safe to call from any thread.
+		void wake(Scenario* scenario);
+
+		/// @brief Runs every added scenario to completion.
+		void run();
+
+		long long get_num_resumes() const { return num_resumes_; }
+		long long get_num_parks() const { return num_parks_; }
+
+	private:
+		void run_worker();
+
+		int num_threads_;
+		int ticks_per_turn_;
+
+		mutex mutex_;
+		condition_variable ready_condition_;
+		deque<Scenario*> ready_;
+		int num_unfinished_;
+		long long num_resumes_;
+		long long num_parks_;
+	};
+
+}  // namespace ride_share
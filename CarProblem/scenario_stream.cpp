@@ -0,0 +1,199 @@
+/**
+ * @file scenario_stream.cpp
+ * @author Ryan McMahon (mcmahonryan@hotmail.com)
+ */
+#include "scenario_stream.h"
+
+namespace ride_share {
+
+	ScenarioStreamReader::ScenarioStreamReader(Dispatcher& dispatcher, function<void()> step) :
+		dispatcher_(&dispatcher),
+		on_request_([&dispatcher](const char* name, int start_x, int start_y, int end_x, int end_y) {
+			dispatcher.new_request(name, start_x, start_y, end_x, end_y);
+		}),
+		step_(step)
+	{
+		in_scenario_ = false;
+		num_steps_read_ = 0;
+	}
+
+	ScenarioStreamReader::ScenarioStreamReader(RequestCallback on_request, function<void()> step) :
+		dispatcher_(nullptr),
+		on_request_(on_request),
+		step_(step)
+	{
+		in_scenario_ = false;
+		num_steps_read_ = 0;
+	}
+
+	void ScenarioStreamReader::run(istream& input) {
+		start_run();
+		json::sax_parse(input, static_cast<nlohmann::json_sax<json>*>(this));
+		finish_run();
+	}
+
+	void ScenarioStreamReader::run(const char* data, size_t size) {
+		start_run();
+		json::sax_parse(data, data + size, static_cast<nlohmann::json_sax<json>*>(this));
+		finish_run();
+	}
+
+	void ScenarioStreamReader::start_run() {
+		in_scenario_ = false;
+		open_containers_.clear();
+	}
+
+	void ScenarioStreamReader::finish_run() {
+		if (!dispatcher_) {
+			return;
+		}
+		dispatcher_->set_last_request_made();
+		while (!dispatcher_->is_done()) {
+			step_();
+		}
+	}
+
+	void ScenarioStreamReader::process_step(json& step_json) {
+		num_steps_read_++;
+		if (!step_json.contains("requests")) {
+			std::string info = "Missing requests object in JSON";
+			JSONException ex(info);
+			throw ex;
+		}
+
+		json& requests_json = *(step_json.find("requests"));
+		for (json::iterator request_it = requests_json.begin(); request_it != requests_json.end(); request_it++) {
+			std::string name;
+			int start_x, start_y, end_x, end_y;
+			process_request_json(*request_it, &name, &start_x, &start_y, &end_x, &end_y);
+
+			on_request_(name.c_str(), start_x, start_y, end_x, end_y);
+		}
+		step_();
+	}
+
+	void ScenarioStreamReader::add_value(json&& value) {
+		if (!in_scenario_) {
+			// A bare value where the scenario array should be: null is an empty scenario, anything else
+			// is a step without requests.
+			if (!value.is_null()) {
+				process_step(value);
+			}
+			return;
+		}
+		if (open_containers_.empty()) {
+			step_json_ = std::move(value);
+			process_step(step_json_);
+			return;
+		}
+		json* container = open_containers_.back();
+		if (container->is_array()) {
+			container->push_back(std::move(value));
+		}
+		else {
+			(*container)[key_] = std::move(value);
+		}
+	}
+
+	void ScenarioStreamReader::open_container(json&& container) {
+		if (!in_scenario_) {
+			in_scenario_ = true;
+			return;
+		}
+		// Only the innermost container grows, so pointers to the enclosing ones stay valid.
+		json* opened;
+		if (open_containers_.empty()) {
+			step_json_ = std::move(container);
+			opened = &step_json_;
+		}
+		else if (open_containers_.back()->is_array()) {
+			open_containers_.back()->push_back(std::move(container));
+			opened = &open_containers_.back()->back();
+		}
+		else {
+			opened = &((*open_containers_.back())[key_] = std::move(container));
+		}
+		open_containers_.push_back(opened);
+	}
+
+	void ScenarioStreamReader::close_container() {
+		if (open_containers_.empty()) {
+			// The scenario itself has closed.
+			in_scenario_ = false;
+			return;
+		}
+		open_containers_.pop_back();
+		if (open_containers_.empty()) {
+			process_step(step_json_);
+			step_json_ = nullptr;
+		}
+	}
+
+	bool ScenarioStreamReader::null() {
+		add_value(json(nullptr));
+		return true;
+	}
+
+	bool ScenarioStreamReader::boolean(bool val) {
+		add_value(json(val));
+		return true;
+	}
+
+	bool ScenarioStreamReader::number_integer(number_integer_t val) {
+		add_value(json(val));
+		return true;
+	}
+
+	bool ScenarioStreamReader::number_unsigned(number_unsigned_t val) {
+		add_value(json(val));
+		return true;
+	}
+
+	bool ScenarioStreamReader::number_float(number_float_t val, const string_t& s) {
+		add_value(json(val));
+		return true;
+	}
+
+	bool ScenarioStreamReader::string(string_t& val) {
+		add_value(json(std::move(val)));
+		return true;
+	}
+
+	bool ScenarioStreamReader::binary(binary_t& val) {
+		add_value(json(json::binary_t(std::move(val))));
+		return true;
+	}
+
+	bool ScenarioStreamReader::start_object(size_t elements) {
+		open_container(json::object());
+		return true;
+	}
+
+	bool ScenarioStreamReader::key(string_t& val) {
+		// Keys of a top-level object are ignored; its values are the steps, as with DOM iteration.
+		key_ = std::move(val);
+		return true;
+	}
+
+	bool ScenarioStreamReader::end_object() {
+		close_container();
+		return true;
+	}
+
+	bool ScenarioStreamReader::start_array(size_t elements) {
+		open_container(json::array());
+		return true;
+	}
+
+	bool ScenarioStreamReader::end_array() {
+		close_container();
+		return true;
+	}
+
+	bool ScenarioStreamReader::parse_error(size_t position, const std::string& last_token, const nlohmann::detail::exception& ex) {
+		std::string info = "Invalid JSON at byte " + to_string(position) + ": " + ex.what();
+		JSONException json_ex(info);
+		throw json_ex;
+	}
+
+}  // namespace ride_share
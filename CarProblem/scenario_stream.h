@@ -0,0 +1,99 @@
+/**
+ * @file scenario_stream.h
+ * @author Ryan McMahon (mcmahonryan@hotmail.com)
+ * @brief Replays a scenario JSON file into a dispatcher while it is being parsed.
+ */
+#pragma once
+#include <functional>
+#include <istream>
+#include <vector>
+#include "request_json.h"
+#include "dispatcher.h"
+
+namespace ride_share {
+
+	/// @brief Feeds a scenario file to a dispatcher one time step at a time, straight from the parser.
+	///
+	/// A scenario is a JSON array with one element per time step, each holding that step's "requests"
+	/// array. Rather than parsing the whole file into a DOM first, the reader takes SAX events and
+	/// builds only the element being read; as soon as it closes, its requests go to
+	/// Dispatcher::new_request() and the step callback runs. Memory therefore depends on the largest
+	/// step, not the length of the file, and the first step runs as soon as it has been read.
+	///
+	/// Errors are reported as before: a malformed request or a step without "requests" throws
+	/// JSONException, an invalid ride throws PassengerException, and a syntax error in the file
+	/// becomes a JSONException rather than nlohmann's own exception.
+	class ScenarioStreamReader : private nlohmann::json_sax<json> {
+	public:
+		/// @brief Receives one parsed request: name, then start and end coordinates.
+		typedef function<void(const char*, int, int, int, int)> RequestCallback;
+
+		/// @param dispatcher Dispatcher to feed; must outlive the reader.
+		/// @param step Called once per time step, after that step's requests have been submitted. It should
+		///        advance the dispatcher, normally with update().
+		ScenarioStreamReader(Dispatcher& dispatcher, function<void()> step);
+
+		/// @brief Reads a scenario without a dispatcher, for tools that convert or inspect it.
+		/// @param on_request Called for each request, in file order.
+		/// @param step Called once per time step, after that step's requests.
+		ScenarioStreamReader(RequestCallback on_request, function<void()> step);
+
+		/// @brief Reads @p input to the end. With a dispatcher, then marks the last request made and keeps
+		///        stepping until the dispatcher is done.
+		void run(istream& input);
+
+		/// @brief Same as run(istream&) over @p size bytes in memory, such as a MappedFile, which the parser
+		///        reads in place.
+		void run(const char* data, size_t size);
+
+		/// @brief Returns the number of time steps read from the file so far.
+		int get_num_steps_read() const { return num_steps_read_; }
+
+	private:
+		/// @brief Resets the parse state before a run.
+		void start_run();
+
+		/// @brief Marks the last request made and steps until the dispatcher, if any, is done.
+		void finish_run();
+
+		/// @brief Submits the requests of one parsed step and runs the step callback.
+		void process_step(json& step_json);
+
+		/// @brief Adds a completed value to the element being built, or finishes the element.
+		void add_value(json&& value);
+
+		/// @brief Like add_value(), for an object or array that stays open for the values that follow.
+		void open_container(json&& container);
+
+		/// @brief Closes the innermost open object or array.
+		void close_container();
+
+		// nlohmann::json_sax
+		bool null() override;
+		bool boolean(bool val) override;
+		bool number_integer(number_integer_t val) override;
+		bool number_unsigned(number_unsigned_t val) override;
+		bool number_float(number_float_t val, const string_t& s) override;
+		bool string(string_t& val) override;
+		bool binary(binary_t& val) override;
+		bool start_object(size_t elements) override;
+		bool key(string_t& val) override;
+		bool end_object() override;
+		bool start_array(size_t elements) override;
+		bool end_array() override;
+		bool parse_error(size_t position, const std::string& last_token, const nlohmann::detail::exception& ex) override;
+
+		/// Null when reading without a dispatcher.
+		Dispatcher* dispatcher_;
+		RequestCallback on_request_;
+		function<void()> step_;
+		/// True once the top-level array (or object) has been opened.
+		bool in_scenario_;
+		/// The step element being built, and the open containers within it, innermost last.
+		json step_json_;
+		vector<json*> open_containers_;
+		std::string key_;
+		int num_steps_read_;
+	};
+
+}  // namespace ride_share
@@ -0,0 +1,19 @@
+/**
+ * @file simulation_arena.cpp
+ * @author Ryan McMahon (mcmahonryan@hotmail.com)
+ */
+#include "simulation_arena.h"
+
+namespace ride_share {
+
+	SimulationArena::SimulationArena(size_t buffer_bytes) :
+		buffer_(new char[buffer_bytes]),
+		resource_(buffer_.get(), buffer_bytes)
+	{
+	}
+
+	void SimulationArena::reset() {
+		resource_.release();
+	}
+
+}  // namespace ride_share
@@ -0,0 +1,41 @@
+/**
+ * @file simulation_arena.h
+ * @author Ryan McMahon (mcmahonryan@hotmail.com)
+ * @brief Monotonic memory arena for batches of short simulations.
+ */
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+
+namespace ride_share {
+
+	using namespace std;
+
+	/// @brief One preallocated buffer that a Dispatcher draws all of its memory from.
+	///
+	/// Allocation is a pointer bump and freeing is a no-op. Everything is released at once by reset(),
+	/// which rewinds to the start of the buffer, so back-to-back simulations that fit in the buffer
+	/// never touch the global heap. If a simulation outgrows the buffer, the overflow comes from the
+	/// heap and is returned on the next reset().
+	class SimulationArena {
+	public:
+		/// @param buffer_bytes Size of the preallocated buffer.
+		explicit SimulationArena(size_t buffer_bytes);
+		SimulationArena(const SimulationArena&) = delete;
+		SimulationArena& operator=(const SimulationArena&) = delete;
+
+		/// @brief Returns the resource to pass to the Dispatcher constructor.
+		pmr::memory_resource* get_resource() { return &resource_; }
+
+		/// @brief Releases everything allocated since the last reset.
+		///
+		/// Every Dispatcher using this arena must already have been destroyed.
+		void reset();
+
+	private:
+		unique_ptr<char[]> buffer_;
+		pmr::monotonic_buffer_resource resource_;
+	};
+
+}  // namespace ride_share
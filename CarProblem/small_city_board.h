@@ -0,0 +1,190 @@
+/**
+ * @file small_city_board.h
+ * @author Ryan McMahon (mcmahonryan@hotmail.com)
+ * @brief Bitboard occupancy tracking for cities small enough to fit in a few machine words.
+ */
+#pragma once
+#include <cstdint>
+#include <bitset>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#include "point.h"
+#include "city_grid.h"
+
+namespace ride_share {
+
+	/// @brief The kinds of cell a SmallCityBoard tracks.
+	enum class BoardLayer {
+		Pickups,            ///< Pickup points of passengers still waiting.
+		DropOffs,           ///< Drop-off points of passengers still waiting.
+		InCarDestinations,  ///< Drop-off points of passengers riding in the car.
+		Count
+	};
+
+	/// @brief Returns the number of set bits in @p word.
+	inline int popcount64(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+		return __builtin_popcountll(word);
+#else
+		return (int)bitset<64>(word).count();
+#endif
+	}
+
+	/// @brief Returns the index of the lowest set bit in @p word, which must be non-zero.
+	inline int lowest_bit_index(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+		return __builtin_ctzll(word);
+#elif defined(_MSC_VER) && defined(_M_X64)
+		unsigned long index;
+		_BitScanForward64(&index, word);
+		return (int)index;
+#else
+		unsigned long index;
+		if (_BitScanForward(&index, (unsigned long)word)) {
+			return (int)index;
+		}
+		_BitScanForward(&index, (unsigned long)(word >> 32));
+		return (int)index + 32;
+#endif
+	}
+
+	/// @brief Bitboards of pickup cells, drop-off cells and in-car destinations for a city of at most
+	///        @p kMaxCells intersections.
+	///
+	/// Each layer keeps a per-cell passenger count plus one bit per cell that is set while the count is
+	/// non-zero. A car goal is any cell with a waiting pickup or an in-car destination. With everything
+	/// fitting in kNumWords words, "is there a goal here / on this row / on this column?" is a handful of
+	/// ANDs, and "nearest goal" only visits occupied cells via bit scans.
+	template <int kMaxCells>
+	class SmallCityBoard {
+	public:
+		static const int kNumWords = (kMaxCells + 63) / 64;
+		static const int kNumLayers = (int)BoardLayer::Count;
+
+		/// @brief Returns true if every cell of @p grid fits in this board. Each row and column also needs
+		///        one of the kMaxCells masks.
+		static bool fits(const CityGrid& grid) {
+			return grid.get_width() <= kMaxCells && grid.get_height() <= kMaxCells && grid.get_num_cells() <= (long long)kMaxCells;
+		}
+
+		/// @param grid City to track. If it does not satisfy fits(), the board is left empty and must not be used.
+		explicit SmallCityBoard(const CityGrid& grid) :
+			width_(fits(grid) ? grid.get_width() : 0),
+			height_(fits(grid) ? grid.get_height() : 0)
+		{
+			clear();
+			for (int word = 0; word < kNumWords; word++) {
+				for (int i = 0; i < kMaxCells; i++) {
+					row_masks_[i][word] = 0;
+					column_masks_[i][word] = 0;
+				}
+			}
+			for (int y = 0; y < height_; y++) {
+				for (int x = 0; x < width_; x++) {
+					int cell = get_cell_index(Point(x, y));
+					row_masks_[y][cell / 64] |= (uint64_t)1 << (cell % 64);
+					column_masks_[x][cell / 64] |= (uint64_t)1 << (cell % 64);
+				}
+			}
+		}
+
+		/// @brief Empties every layer.
+		void clear() {
+			for (int layer = 0; layer < kNumLayers; layer++) {
+				for (int word = 0; word < kNumWords; word++) {
+					bits_[layer][word] = 0;
+				}
+				for (int i = 0; i < kMaxCells; i++) {
+					counts_[layer][i] = 0;
+				}
+			}
+		}
+
+		/// @brief Adds one passenger to @p layer at @p pt.
+		void add(BoardLayer layer, const Point& pt) {
+			int cell = get_cell_index(pt);
+			if (counts_[(int)layer][cell]++ == 0) {
+				bits_[(int)layer][cell / 64] |= (uint64_t)1 << (cell % 64);
+			}
+		}
+
+		/// @brief Removes one passenger from @p layer at @p pt.
+		void remove(BoardLayer layer, const Point& pt) {
+			int cell = get_cell_index(pt);
+			if (--counts_[(int)layer][cell] == 0) {
+				bits_[(int)layer][cell / 64] &= ~((uint64_t)1 << (cell % 64));
+			}
+		}
+
+		/// @brief Returns the number of passengers in @p layer at @p pt.
+		int get_count(BoardLayer layer, const Point& pt) const { return counts_[(int)layer][get_cell_index(pt)]; }
+
+		/// @brief Returns true if the car has a reason to stop at @p pt.
+		bool has_goal_at(const Point& pt) const {
+			int cell = get_cell_index(pt);
+			return ((get_goal_word(cell / 64) >> (cell % 64)) & 1) != 0;
+		}
+
+		/// @brief Returns true if any goal lies on row @p y.
+		bool any_goal_in_row(int y) const { return intersects_goals(row_masks_[y]); }
+
+		/// @brief Returns true if any goal lies on column @p x.
+		bool any_goal_in_column(int x) const { return intersects_goals(column_masks_[x]); }
+
+		/// @brief Returns the number of distinct cells holding a goal.
+		int count_goal_cells() const {
+			int count = 0;
+			for (int word = 0; word < kNumWords; word++) {
+				count += popcount64(get_goal_word(word));
+			}
+			return count;
+		}
+
+		/// @brief Finds the goal closest to @p from by Manhattan distance; ties go to the lowest cell index.
+		/// @param ret_goal Receives the goal position.
+		/// @return False if there are no goals.
+		bool find_nearest_goal(const Point& from, Point* ret_goal) const {
+			int best_dist = -1;
+			for (int word = 0; word < kNumWords; word++) {
+				uint64_t bits = get_goal_word(word);
+				while (bits != 0) {
+					int cell = word * 64 + lowest_bit_index(bits);
+					bits &= bits - 1;
+					Point pt(cell % width_, cell / width_);
+					int dist = Point::get_dist(from, pt);
+					if (best_dist < 0 || dist < best_dist) {
+						best_dist = dist;
+						*ret_goal = pt;
+					}
+				}
+			}
+			return best_dist >= 0;
+		}
+
+	private:
+		int get_cell_index(const Point& pt) const { return pt.y() * width_ + pt.x(); }
+
+		uint64_t get_goal_word(int word) const {
+			return bits_[(int)BoardLayer::Pickups][word] | bits_[(int)BoardLayer::InCarDestinations][word];
+		}
+
+		bool intersects_goals(const uint64_t* mask) const {
+			for (int word = 0; word < kNumWords; word++) {
+				if ((get_goal_word(word) & mask[word]) != 0) {
+					return true;
+				}
+			}
+			return false;
+		}
+
+		int width_;
+		int height_;
+		uint64_t bits_[kNumLayers][kNumWords];
+		uint32_t counts_[kNumLayers][kMaxCells];
+		/// Indexed by row (or column); only the first height_ (or width_) entries are used.
+		uint64_t row_masks_[kMaxCells][kNumWords];
+		uint64_t column_masks_[kMaxCells][kNumWords];
+	};
+
+}  // namespace ride_share
@@ -0,0 +1,283 @@
+/**
+ * @file tick_event_ring.cpp
+ * @author Ryan McMahon (mcmahonryan@hotmail.com)
+ */
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include "tick_event_ring.h"
+
+#if RIDE_SHARE_HAS_POSIX_SHM
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ride_share {
+
+	static_assert(is_trivially_copyable<TickEvent>::value && sizeof(TickEvent) == 64, "TickEvent must be a 64-byte plain record");
+	static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "shared-memory atomics must be lock-free to work across processes");
+
+#if RIDE_SHARE_HAS_POSIX_SHM
+
+	/// "RSEVRING", identifying the shared-memory layout.
+	static const uint64_t kRingMagic = 0x474E495256455352ULL;
+	static const uint32_t kRingVersion = 1;
+	static const int kEventWords = sizeof(TickEvent) / sizeof(uint64_t);
+
+	/// Start of the shared-memory object. The slots follow it.
+	struct RingHeader {
+		uint64_t magic_;
+		uint32_t version_;
+		uint32_t capacity_;
+		/// Number of events published so far. On its own cache line, since every reader polls it.
+		alignas(64) atomic<uint64_t> write_sequence_;
+	};
+
+	/// One event, guarded by a seqlock. For event n, the sequence is 2n + 1 while it is being written
+	/// and 2n + 2 once it is complete. The payload is copied as relaxed atomic words, so a reader racing
+	/// the writer gets a torn copy that the sequence check rejects, never undefined behavior.
+	struct RingSlot {
+		atomic<uint64_t> sequence_;
+		atomic<uint64_t> words_[kEventWords];
+	};
+
+	static size_t get_mapping_size(uint32_t capacity) {
+		return sizeof(RingHeader) + (size_t)capacity * sizeof(RingSlot);
+	}
+
+	static RingSlot* get_slots(void* mapping) {
+		return (RingSlot*)((char*)mapping + sizeof(RingHeader));
+	}
+
+	static const RingSlot* get_slots(const void* mapping) {
+		return (const RingSlot*)((const char*)mapping + sizeof(RingHeader));
+	}
+
+	/// @brief Throws a SharedMemoryException describing the failed call and errno.
+	static void throw_shm_error(const char* what, const string& name) {
+		string info = string(what) + " failed for " + name + ": " + strerror(errno);
+		SharedMemoryException ex(info);
+		throw ex;
+	}
+
+	TickEventRingPublisher::TickEventRingPublisher(const string& name, int capacity) :
+		name_(name),
+		mapping_(nullptr),
+		next_sequence_(0),
+		tick_(0)
+	{
+		uint32_t rounded_capacity = 2;
+		while (rounded_capacity < (uint32_t)capacity) {
+			rounded_capacity *= 2;
+		}
+		mapping_size_ = get_mapping_size(rounded_capacity);
+
+		shm_unlink(name_.c_str());
+		int fd = shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+		if (fd < 0) {
+			throw_shm_error("shm_open", name_);
+		}
+		if (ftruncate(fd, (off_t)mapping_size_) != 0) {
+			close(fd);
+			shm_unlink(name_.c_str());
+			throw_shm_error("ftruncate", name_);
+		}
+		void* mapping = mmap(nullptr, mapping_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		close(fd);
+		if (mapping == MAP_FAILED) {
+			shm_unlink(name_.c_str());
+			throw_shm_error("mmap", name_);
+		}
+		mapping_ = mapping;
+
+		RingHeader* header = new (mapping_) RingHeader();
+		header->magic_ = kRingMagic;
+		header->version_ = kRingVersion;
+		header->capacity_ = rounded_capacity;
+		header->write_sequence_.store(0, memory_order_relaxed);
+		RingSlot* slots = get_slots(mapping_);
+		for (uint32_t i = 0; i < rounded_capacity; i++) {
+			RingSlot* slot = new (&slots[i]) RingSlot();
+			slot->sequence_.store(0, memory_order_relaxed);
+		}
+		atomic_thread_fence(memory_order_release);
+	}
+
+	TickEventRingPublisher::~TickEventRingPublisher() {
+		if (mapping_) {
+			munmap(mapping_, mapping_size_);
+			shm_unlink(name_.c_str());
+		}
+	}
+
+	void TickEventRingPublisher::publish(TickEventType type, PassengerData* passenger) {
+		TickEvent event;
+		memset(&event, 0, sizeof(event));
+		event.type_ = (uint32_t)type;
+		event.tick_ = tick_;
+		event.x_ = car_pos_.x();
+		event.y_ = car_pos_.y();
+		event.passenger_id_ = -1;
+		if (passenger) {
+			PassengerHandle handle = passenger->get_handle();
+			event.passenger_id_ = handle.id();
+			event.passenger_generation_ = handle.generation();
+			strncpy(event.name_, passenger->get_name().c_str(), TickEvent::kMaxNameLength);
+		}
+		uint64_t words[kEventWords];
+		memcpy(words, &event, sizeof(event));
+
+		RingHeader* header = (RingHeader*)mapping_;
+		RingSlot& slot = get_slots(mapping_)[next_sequence_ & (header->capacity_ - 1)];
+		slot.sequence_.store(2 * next_sequence_ + 1, memory_order_relaxed);
+		atomic_thread_fence(memory_order_release);
+		for (int i = 0; i < kEventWords; i++) {
+			slot.words_[i].store(words[i], memory_order_relaxed);
+		}
+		slot.sequence_.store(2 * next_sequence_ + 2, memory_order_release);
+		next_sequence_++;
+		header->write_sequence_.store(next_sequence_, memory_order_release);
+	}
+
+	void TickEventRingPublisher::on_car_moved(const Point& car_pos, int time) {
+		// Called once per step, before any of the step's pickups and drop-offs.
+		tick_ = time;
+		car_pos_ = car_pos;
+		publish(TickEventType::CarMoved, nullptr);
+	}
+
+	void TickEventRingPublisher::on_pickup(PassengerData* passenger) {
+		publish(TickEventType::PickedUp, passenger);
+	}
+
+	void TickEventRingPublisher::on_drop_off(PassengerData* passenger) {
+		publish(TickEventType::DroppedOff, passenger);
+	}
+
+	TickEventRingReader::TickEventRingReader(const string& name) :
+		mapping_(nullptr),
+		mapping_size_(0),
+		next_sequence_(0),
+		num_dropped_(0)
+	{
+		int fd = shm_open(name.c_str(), O_RDONLY, 0);
+		if (fd < 0) {
+			throw_shm_error("shm_open", name);
+		}
+		struct stat file_stat;
+		if (fstat(fd, &file_stat) != 0) {
+			close(fd);
+			throw_shm_error("fstat", name);
+		}
+		size_t size = (size_t)file_stat.st_size;
+		void* mapping = (size >= sizeof(RingHeader)) ? mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+		close(fd);
+		if (mapping == MAP_FAILED) {
+			throw_shm_error("mmap", name);
+		}
+
+		const RingHeader* header = (const RingHeader*)mapping;
+		if (header->magic_ != kRingMagic || header->version_ != kRingVersion || size != get_mapping_size(header->capacity_)) {
+			munmap(mapping, size);
+			string info = "Shared memory " + name + " is not a tick event ring";
+			SharedMemoryException ex(info);
+			throw ex;
+		}
+		mapping_ = mapping;
+		mapping_size_ = size;
+	}
+
+	TickEventRingReader::~TickEventRingReader() {
+		if (mapping_) {
+			munmap((void*)mapping_, mapping_size_);
+		}
+	}
+
+	bool TickEventRingReader::read(TickEvent* ret_event) {
+		const RingHeader* header = (const RingHeader*)mapping_;
+		const RingSlot* slots = get_slots(mapping_);
+		uint64_t capacity = header->capacity_;
+		for (;;) {
+			uint64_t write_sequence = header->write_sequence_.load(memory_order_acquire);
+			if (next_sequence_ >= write_sequence) {
+				return false;
+			}
+			if (write_sequence - next_sequence_ > capacity) {
+				uint64_t oldest = write_sequence - capacity;
+				num_dropped_ += (long long)(oldest - next_sequence_);
+				next_sequence_ = oldest;
+			}
+
+			const RingSlot& slot = slots[next_sequence_ & (capacity - 1)];
+			uint64_t expected = 2 * next_sequence_ + 2;
+			uint64_t words[kEventWords];
+			if (slot.sequence_.load(memory_order_acquire) == expected) {
+				for (int i = 0; i < kEventWords; i++) {
+					words[i] = slot.words_[i].load(memory_order_relaxed);
+				}
+				atomic_thread_fence(memory_order_acquire);
+				if (slot.sequence_.load(memory_order_relaxed) == expected) {
+					memcpy(ret_event, words, sizeof(*ret_event));
+					next_sequence_++;
+					return true;
+				}
+			}
+			// The publisher lapped us while we were reading this slot: the event is gone.
+			num_dropped_++;
+			next_sequence_++;
+		}
+	}
+
+#else
+
+	TickEventRingPublisher::TickEventRingPublisher(const string& name, int capacity) :
+		name_(name),
+		mapping_(nullptr),
+		mapping_size_(0),
+		next_sequence_(0),
+		tick_(0)
+	{
+		string info = "POSIX shared memory is not supported on this platform";
+		SharedMemoryException ex(info);
+		throw ex;
+	}
+
+	TickEventRingPublisher::~TickEventRingPublisher() {
+	}
+
+	void TickEventRingPublisher::publish(TickEventType type, PassengerData* passenger) {
+	}
+
+	void TickEventRingPublisher::on_car_moved(const Point& car_pos, int time) {
+	}
+
+	void TickEventRingPublisher::on_pickup(PassengerData* passenger) {
+	}
+
+	void TickEventRingPublisher::on_drop_off(PassengerData* passenger) {
+	}
+
+	TickEventRingReader::TickEventRingReader(const string& name) :
+		mapping_(nullptr),
+		mapping_size_(0),
+		next_sequence_(0),
+		num_dropped_(0)
+	{
+		string info = "POSIX shared memory is not supported on this platform";
+		SharedMemoryException ex(info);
+		throw ex;
+	}
+
+	TickEventRingReader::~TickEventRingReader() {
+	}
+
+	bool TickEventRingReader::read(TickEvent* ret_event) {
+		return false;
+	}
+
+#endif
+
+}  // namespace ride_share
@@ -0,0 +1,133 @@
+/**
+ * @file tick_event_ring.h
+ * @author Ryan McMahon (mcmahonryan@hotmail.com)
+ * @brief Single-producer, multi-consumer ring of binary tick events in POSIX shared memory.
+ */
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include "dispatcher.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define RIDE_SHARE_HAS_POSIX_SHM 1
+#else
+#define RIDE_SHARE_HAS_POSIX_SHM 0
+#endif
+
+namespace ride_share {
+
+	using namespace std;
+
+	/// @brief Exception thrown when a shared-memory ring cannot be created or opened.
+	class SharedMemoryException {
+	public:
+		SharedMemoryException() {
+			info_ = "";
+		}
+		SharedMemoryException(const char* info) {
+			info_ = info;
+		}
+		SharedMemoryException(const string& info) {
+			info_ = info;
+		}
+		string get_info() { return info_; }
+	private:
+		string info_;
+	};
+
+	enum class TickEventType : uint32_t {
+		CarMoved = 1,
+		PickedUp = 2,
+		DroppedOff = 3
+	};
+
+	/// @brief One fixed-size binary event, as stored in the ring.
+	///
+	/// For CarMoved, x and y are the car's position after the step. For PickedUp and DroppedOff they
+	/// are the car's position too (where the event happened), and the passenger fields are filled in.
+	class TickEvent {
+	public:
+		static const int kMaxNameLength = 39;
+
+		TickEventType get_type() const { return (TickEventType)type_; }
+		/// @brief Returns the dispatcher's clock after the step the event happened in.
+		int get_tick() const { return tick_; }
+		Point get_pos() const { return Point(x_, y_); }
+		/// @brief Roster ID and generation of the passenger; see PassengerHandle.
+		PassengerHandle get_passenger() const { return PassengerHandle(passenger_id_, passenger_generation_); }
+		/// @brief Passenger name, truncated to kMaxNameLength characters.
+		const char* get_name() const { return name_; }
+
+	private:
+		friend class TickEventRingPublisher;
+		uint32_t type_;
+		int32_t tick_;
+		int32_t x_;
+		int32_t y_;
+		int32_t passenger_id_;
+		uint32_t passenger_generation_;
+		char name_[kMaxNameLength + 1];
+	};
+
+	/// @brief Dispatcher sink that publishes every event into a named shared-memory ring.
+	///
+	/// Events are stamped with the dispatcher's clock, so the publisher can be attached at any point in
+	/// a simulation, or share the dispatcher with other sinks through a FanOutEventSink.
+	///
+	/// Other processes open the ring by name with TickEventRingReader. The publisher never waits for
+	/// readers: each slot is a small seqlock, so writing just overwrites the oldest event, and a reader
+	/// that falls a full lap behind notices and skips ahead. The shared memory is unlinked when the
+	/// publisher is destroyed; readers that still have it mapped keep working until they close.
+	class TickEventRingPublisher : public DispatchEventSink {
+	public:
+		/// @param name Shared-memory object name, e.g. "/ride_share_events". An existing one is replaced.
+		/// @param capacity Number of events the ring holds; rounded up to a power of two.
+		TickEventRingPublisher(const string& name, int capacity);
+		~TickEventRingPublisher();
+		TickEventRingPublisher(const TickEventRingPublisher&) = delete;
+		TickEventRingPublisher& operator=(const TickEventRingPublisher&) = delete;
+
+		void on_car_moved(const Point& car_pos, int time) override;
+		void on_pickup(PassengerData* passenger) override;
+		void on_drop_off(PassengerData* passenger) override;
+
+		long long get_num_published() const { return next_sequence_; }
+
+	private:
+		void publish(TickEventType type, PassengerData* passenger);
+
+		string name_;
+		void* mapping_;
+		size_t mapping_size_;
+		uint64_t next_sequence_;
+		int tick_;
+		Point car_pos_;
+	};
+
+	/// @brief Reads a TickEventRingPublisher's events, from the oldest still in the ring onward.
+	///
+	/// Each reader keeps its own position, so any number can read at once, in any process.
+	class TickEventRingReader {
+	public:
+		/// @param name Name the publisher was created with. Throws SharedMemoryException if there is no such ring.
+		explicit TickEventRingReader(const string& name);
+		~TickEventRingReader();
+		TickEventRingReader(const TickEventRingReader&) = delete;
+		TickEventRingReader& operator=(const TickEventRingReader&) = delete;
+
+		/// @brief Copies the next event into @p ret_event.
+		/// @return False if the reader has caught up with the publisher.
+		bool read(TickEvent* ret_event);
+
+		/// @brief Returns how many events were overwritten before this reader got to them.
+		long long get_num_dropped() const { return num_dropped_; }
+
+	private:
+		const void* mapping_;
+		size_t mapping_size_;
+		uint64_t next_sequence_;
+		long long num_dropped_;
+	};
+
+}  // namespace ride_share
@@ -0,0 +1,68 @@
+/**
+ * @file tick_scheduler.cpp
+ * @author Ryan McMahon (mcmahonryan@hotmail.com)
+ */
+#include <thread>
+#include "tick_scheduler.h"
+
+namespace ride_share {
+
+	/// Catch-up limit used until set_max_catch_up_ticks() is called.
+	static const int kDefaultMaxCatchUpTicks = 5;
+
+	/// Samples preallocated per run, so recording does not allocate during the first ticks.
+	static const size_t kReservedSamples = 4096;
+
+	TickScheduler::TickScheduler(Dispatcher& dispatcher, Clock::duration period) :
+		dispatcher_(dispatcher),
+		sink_(nullptr),
+		period_(period),
+		slo_(period),
+		max_catch_up_ticks_(kDefaultMaxCatchUpTicks),
+		stop_requested_(false)
+	{
+	}
+
+	void TickScheduler::run(int max_ticks) {
+		statistics_ = TickStatistics();
+		statistics_.jitter_.reserve(kReservedSamples);
+		statistics_.work_time_.reserve(kReservedSamples);
+		stop_requested_ = false;
+
+		DispatchEventSink discard;
+		DispatchEventSink& sink = sink_ ? *sink_ : discard;
+		Clock::time_point deadline = Clock::now() + period_;
+
+		while (!dispatcher_.is_done() && !stop_requested_.load() && (max_ticks < 0 || statistics_.num_ticks_ < max_ticks)) {
+			Clock::time_point now = Clock::now();
+			if (now - deadline > period_ * max_catch_up_ticks_) {
+				// Too far behind to catch up: forget the missed slots and run this tick now.
+				statistics_.num_resyncs_++;
+				statistics_.num_skipped_periods_ += (now - deadline) / period_;
+				deadline = now;
+			}
+			bool catching_up = (now - deadline >= period_);
+			if (!catching_up) {
+				this_thread::sleep_until(deadline);
+			}
+
+			Clock::time_point tick_start = Clock::now();
+			dispatcher_.update(sink);
+			Clock::time_point tick_end = Clock::now();
+
+			if (catching_up) {
+				statistics_.num_catch_up_ticks_++;
+			}
+			else {
+				statistics_.jitter_.record(chrono::duration<double, micro>(tick_start - deadline).count());
+			}
+			statistics_.work_time_.record(chrono::duration<double, micro>(tick_end - tick_start).count());
+			if (tick_end - deadline > slo_) {
+				statistics_.num_slo_violations_++;
+			}
+			statistics_.num_ticks_++;
+			deadline += period_;
+		}
+	}
+
+}  // namespace ride_share
@@ -0,0 +1,90 @@
+/**
+ * @file tick_scheduler.h
+ * @author Ryan McMahon (mcmahonryan@hotmail.com)
+ * @brief Runs a dispatcher at a fixed wall-clock tick rate.
+ */
+#pragma once
+#include <atomic>
+#include <chrono>
+#include "dispatcher.h"
+#include "latency_recorder.h"
+
+namespace ride_share {
+
+	using namespace std;
+
+	/// @brief Timing results collected by TickScheduler::run().
+	///
+	/// Jitter is how late a tick started against its scheduled time; work time is how long update() took.
+	/// Both are in microseconds. Ticks run back-to-back to catch up after an overrun are counted but not
+	/// added to the jitter samples, since they are late by design.
+	class TickStatistics {
+	public:
+		int get_num_ticks() const { return num_ticks_; }
+		/// @brief Ticks whose update() finished more than the SLO after their scheduled time.
+		int get_num_slo_violations() const { return num_slo_violations_; }
+		/// @brief Ticks that started at least one period late and ran without sleeping.
+		int get_num_catch_up_ticks() const { return num_catch_up_ticks_; }
+		/// @brief Times the schedule fell too far behind and was restarted from the current time.
+		int get_num_resyncs() const { return num_resyncs_; }
+		/// @brief Scheduled tick times abandoned by resyncs. No simulation steps are lost, only wall time.
+		long long get_num_skipped_periods() const { return num_skipped_periods_; }
+		const LatencyRecorder& get_jitter() const { return jitter_; }
+		const LatencyRecorder& get_work_time() const { return work_time_; }
+
+	private:
+		friend class TickScheduler;
+		int num_ticks_ = 0;
+		int num_slo_violations_ = 0;
+		int num_catch_up_ticks_ = 0;
+		int num_resyncs_ = 0;
+		long long num_skipped_periods_ = 0;
+		LatencyRecorder jitter_;
+		LatencyRecorder work_time_;
+	};
+
+	/// @brief Calls Dispatcher::update() once per period of a monotonic clock.
+	///
+	/// Tick k is scheduled for start + k * period. After an overrun, the missed ticks run immediately,
+	/// one after another, until the schedule is met again; each is still exactly one simulation step, so
+	/// the simulation does not depend on timing (apart from when queued requests arrive). If the schedule
+	/// falls more than the catch-up limit behind, it is restarted from the current time instead, so one
+	/// long stall cannot cause an unbounded burst of ticks.
+	class TickScheduler {
+	public:
+		typedef chrono::steady_clock Clock;
+
+		/// @param dispatcher Dispatcher to drive; must outlive the scheduler.
+		/// @param period Time between ticks. The SLO defaults to the same value.
+		TickScheduler(Dispatcher& dispatcher, Clock::duration period);
+
+		/// @brief Sets the latency objective: each tick must finish within @p slo of its scheduled time.
+		void set_slo(Clock::duration slo) { slo_ = slo; }
+
+		/// @brief Sets how many periods behind the schedule may fall before it is restarted.
+		void set_max_catch_up_ticks(int max_ticks) { max_catch_up_ticks_ = max_ticks; }
+
+		/// @brief Passes @p sink to every update(). Pass nullptr to discard the events.
+		void set_event_sink(DispatchEventSink* sink) { sink_ = sink; }
+
+		/// @brief Ticks until the dispatcher is done, stop() is called, or @p max_ticks have run (if not negative).
+		///
+		/// Statistics from earlier runs are cleared first.
+		void run(int max_ticks = -1);
+
+		/// @brief Makes run() return after the current tick. Safe to call from any thread.
+		void stop() { stop_requested_ = true; }
+
+		const TickStatistics& get_statistics() const { return statistics_; }
+
+	private:
+		Dispatcher& dispatcher_;
+		DispatchEventSink* sink_;
+		Clock::duration period_;
+		Clock::duration slo_;
+		int max_catch_up_ticks_;
+		atomic<bool> stop_requested_;
+		TickStatistics statistics_;
+	};
+
+}  // namespace ride_share